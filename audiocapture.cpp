@@ -5,8 +5,37 @@
 #include <QtEndian>
 #include <QElapsedTimer>
 
+#include "pipelinetrace.h"
+#include "recognizerprofile.h"
+#include "speakerdiarizer.h"
+#include "punctuationworker.h"
+#include "audiofilereader.h"
 
-AudioCapture::AudioCapture(QObject *parent) : QObject(parent)
+#include <atomic>
+
+namespace {
+
+// 所有采集实例共用的结果序号，多个实例的结果显示在同一列表中也能按序号区分和排序
+std::atomic<qint64> g_nextVoiceId{0};
+
+} // namespace
+
+void appendTranscript(QString &text, const QString &piece)
+{
+    if (!text.isEmpty() && !piece.isEmpty()
+        && text.back().isLetter() && text.back().unicode() < 0x80
+        && piece.front().isLetter() && piece.front().unicode() < 0x80) {
+        text.append(' ');
+    }
+    text.append(piece);
+}
+
+AudioCapture::AudioCapture(QObject *parent)
+    : AudioCapture(CaptureSettings(), parent)
+{
+}
+
+AudioCapture::AudioCapture(const CaptureSettings &settings, QObject *parent) : QObject(parent)
 {
     setupAudioFormat();
     m_timer = new QTimer(this);
@@ -33,10 +62,10 @@ AudioCapture::AudioCapture(QObject *parent) : QObject(parent)
     // Silero VAD 配置参数
     vadConfig.silero_vad.model = vad_filename;
     vadConfig.silero_vad.threshold = 0.3;           // 语音活动检测的阈值，范围[0,1]，值越小对语音越敏感
-    vadConfig.silero_vad.min_silence_duration = 0.2; // 最小静音持续时间（秒），短于此时间的静音会被忽略
+    vadConfig.silero_vad.min_silence_duration = settings.minSilenceDuration; // 最小静音持续时间（秒），短于此时间的静音会被忽略
     vadConfig.silero_vad.min_speech_duration = 0.2;  // 最小语音持续时间（秒），短于此时间的语音段会被过滤
     vadConfig.silero_vad.max_speech_duration = 10;   // 最大单段语音持续时间（秒），用于限制单次语音输入长度
-    vadConfig.silero_vad.window_size = 512;          // 分析窗口大小（采样点数），影响VAD的时间分辨率
+    vadConfig.silero_vad.window_size = settings.windowSize; // 分析窗口大小（采样点数），影响VAD的时间分辨率
 
     // 音频处理基础配置
     vadConfig.sample_rate = 16000;  // 音频采样率（Hz），通常使用16kHz用于语音处理
@@ -52,35 +81,41 @@ AudioCapture::AudioCapture(QObject *parent) : QObject(parent)
 
 
 
-    // Paraformer config
-    const char *model_filename =
-        "sherpa-onnx-paraformer-zh-small/model.int8.onnx";
-    const char *tokens_filename =
-        "sherpa-onnx-paraformer-zh-small/tokens.txt";
-    const char *provider = "cpu";
-    memset(&paraformer_config, 0, sizeof(paraformer_config));
-    paraformer_config.model = model_filename;
-
-    // Offline model config
-    memset(&offline_model_config, 0, sizeof(offline_model_config));
-    offline_model_config.debug = 0;
-    offline_model_config.num_threads = 2;
-    offline_model_config.provider = provider;
-    offline_model_config.tokens = tokens_filename;
-    offline_model_config.paraformer = paraformer_config;
+    // 识别器使用本机校准得到的模型、后端和线程数
+    recognizer = RecognizerCalibration::createRecognizer(
+        settings.profile ? *settings.profile : RecognizerCalibration::profile(), settings.numThreads);
+    m_interactive = settings.interactive;
+    if (recognizer != NULL) {
+        m_decodeSession = DecodeScheduler::instance().addSession(recognizer, m_interactive,
+                                                                 settings.decodeSloSeconds);
+    }
 
-    // Recognizer config
-    SherpaOnnxOfflineRecognizerConfig recognizer_config;
-    memset(&recognizer_config, 0, sizeof(recognizer_config));
-    recognizer_config.decoding_method = "greedy_search";
-    recognizer_config.model_config = offline_model_config;
+    // 说话人分离
+    if (settings.diarization) {
+        m_diarizer = new SpeakerDiarizer("./speaker/speaker_embedding.onnx", 2, 0.5f, this);
+        if (m_diarizer->isReady()) {
+            connect(m_diarizer, &SpeakerDiarizer::speakerAssigned,
+                    this, &AudioCapture::onSpeakerAssigned, Qt::QueuedConnection);
+        }
+    }
 
-    recognizer = SherpaOnnxCreateOfflineRecognizer(&recognizer_config);
+    // 标点
+    if (settings.punctuation) {
+        m_punctuation = new PunctuationWorker("./punct/model.onnx", this);
+        if (m_punctuation->isReady()) {
+            connect(m_punctuation, &PunctuationWorker::punctuated,
+                    this, &AudioCapture::onPunctuated, Qt::QueuedConnection);
+        }
+    }
 }
 
 AudioCapture::~AudioCapture()
 {
     stopCapture();
+    // 先等共享解码线程放下本会话的片段，再销毁识别器
+    if (m_decodeSession >= 0) {
+        DecodeScheduler::instance().removeSession(m_decodeSession);
+    }
     SherpaOnnxDestroyVoiceActivityDetector(vad);
     SherpaOnnxDestroyOfflineRecognizer(recognizer);
 }
@@ -124,6 +159,9 @@ void AudioCapture::startCapture()
 
     // 重置计数器
     m_totalBytesProcessed = 0; // 确保这里使用了成员变量
+    m_timeBase = m_samplesFed;
+    DecodeScheduler::instance().setSessionInteractive(m_decodeSession, m_interactive);
+    setActive(true);
 
     // 使用更精确的定时器
     m_timer->start();
@@ -134,12 +172,61 @@ void AudioCapture::startCapture()
              << "\nResampling:" << (m_resampleRequired ? "Yes" : "No");
 }
 
+void AudioCapture::startReplay(const std::vector<float> &samples)
+{
+    if (m_audioSource || !m_replaySamples.empty()) return;
+    voiceData.clear();
+
+    m_replaySamples = samples;
+    m_replayPos = 0;
+    m_timeBase = m_samplesFed;
+    m_finishPending = false;
+    DecodeScheduler::instance().setSessionInteractive(m_decodeSession, m_interactive);
+    setActive(true);
+    m_replayClock.start();
+    m_timer->start();
+}
+
+bool AudioCapture::startFile(const QString &path, double offsetSeconds)
+{
+    if (m_audioSource || !m_replaySamples.empty() || m_fileReader) return false;
+
+    m_fileReader = new AudioFileReader;
+    if (!m_fileReader->open(path) || !m_fileReader->seek(offsetSeconds)) {
+        emit errorOccurred(m_fileReader->errorString().isEmpty()
+                               ? QString("Failed to seek %1 to %2 s").arg(path).arg(offsetSeconds)
+                               : m_fileReader->errorString());
+        delete m_fileReader;
+        m_fileReader = nullptr;
+        return false;
+    }
+
+    voiceData.clear();
+    // 时间戳从文件中的起始位置算起
+    m_timeBase = m_samplesFed - static_cast<qint64>(offsetSeconds * sampleRate);
+    m_finishPending = false;
+    // 文件比实时快得多，其片段让位于交互会话
+    DecodeScheduler::instance().setSessionInteractive(m_decodeSession, false);
+    setActive(true);
+    qDebug() << "Decoding" << path << "from" << offsetSeconds << "s,"
+             << m_fileReader->duration() << "s in total";
+    m_timer->start();
+    return true;
+}
+
 void AudioCapture::stopCapture()
 {
     if (m_timer && m_timer->isActive()) {
         m_timer->stop();
     }
 
+    delete m_fileReader;
+    m_fileReader = nullptr;
+
+    m_replaySamples.clear();
+    m_replayPos = 0;
+    m_finishPending = false;
+
     // 处理剩余数据
     if (m_audioIO && m_audioSource) {
         processRemainingData();
@@ -157,6 +244,8 @@ void AudioCapture::stopCapture()
         m_audioQueue.clear();
     }
 
+    resetStream();
+    setActive(false);
     qDebug() << "Total audio data processed:" << m_totalBytesProcessed << "bytes";
 }
 
@@ -183,55 +272,9 @@ void AudioCapture::processRemainingData()
         return;
 
     try{
-        int numSamples = rawData.size() / sizeof(int16_t);
-        const int16_t* pcm = reinterpret_cast<const int16_t*>(rawData.constData());
-        std::vector<float> floatSamples(numSamples);
-        for (int i = 0; i < numSamples; ++i) {
-            floatSamples[i] = pcm[i] / 32768.0f; // int16 -> float [-1, 1]
-        }
-
-        // 直接送入 VAD
-        SherpaOnnxVoiceActivityDetectorAcceptWaveform(vad, floatSamples.data(), numSamples);
-        SherpaOnnxVoiceActivityDetectorFlush(vad);
-
-        while (!SherpaOnnxVoiceActivityDetectorEmpty(vad)) {
-            const SherpaOnnxSpeechSegment *segment =
-                SherpaOnnxVoiceActivityDetectorFront(vad);
+        // 直接送入 VAD，并冲刷出最后一段语音
+        feedVad(rawData, true);
 
-            float start = segment->start / 16000.0f;
-            float duration = segment->n / 16000.0f;
-            float stop = start + duration;
-
-            if (recognizer == NULL) {
-                fprintf(stderr, "Please check your config!\n");
-            }
-            else {
-                const SherpaOnnxOfflineStream *stream =
-                    SherpaOnnxCreateOfflineStream(recognizer);
-
-                try{
-                    SherpaOnnxAcceptWaveformOffline(stream, sampleRate, segment->samples,
-                                                    segment->n);
-                    SherpaOnnxDecodeOfflineStream(recognizer, stream);
-                    const SherpaOnnxOfflineRecognizerResult *result = SherpaOnnxGetOfflineStreamResult(stream);
-
-                    auto tmp = VoiceData(std::make_pair(start, stop), result->text);
-                    emit voiceDataSend(tmp);
-                    voiceData.append(tmp);
-                    // QString context = QString("%1-%2  Decoded text: %s").arg(start, 0, 'f', 3).arg(stop, 0, 'f', 3).arg(result->text);
-
-                    SherpaOnnxDestroyOfflineRecognizerResult(result);
-                }
-                catch (const std::exception& e) {
-                    qDebug() << "Exception in VAD processing:" << e.what();
-                }
-
-                SherpaOnnxDestroyOfflineStream(stream);
-            }
-
-            SherpaOnnxDestroySpeechSegment(segment);
-            SherpaOnnxVoiceActivityDetectorPop(vad);
-        }
         m_audioQueue.enqueue(rawData);
         m_totalBytesProcessed += rawData.size(); // 更新总字节数
 
@@ -247,6 +290,14 @@ void AudioCapture::processRemainingData()
 
 void AudioCapture::processAudioData()
 {
+    if (m_fileReader) {
+        processFileData();
+        return;
+    }
+    if (!m_replaySamples.empty()) {
+        replayAudioData();
+        return;
+    }
     if (!m_audioIO) return;
 
     int bytesPerFrame = m_audioFormat.bytesPerFrame();
@@ -258,6 +309,7 @@ void AudioCapture::processAudioData()
         return;
     }
 
+    TraceScope chunkTrace("capture_chunk", bytesNeeded);
     QByteArray rawData = m_audioIO->read(bytesNeeded);
     if (rawData.isEmpty()) return;
     // qDebug() << QString("sampleRate:%1   bytesNeeded=%2  rawData=%3")
@@ -267,6 +319,7 @@ void AudioCapture::processAudioData()
     // 如果需要重采样
     if (m_resampleRequired) {
         // qDebug() << "Resampling... Original size:" << rawData.size();
+        TraceScope trace("resample", rawData.size());
         rawData = resampleTo16kHzMono(rawData, m_audioFormat);
         // qDebug() << "Resampled size:" << rawData.size();  // 应为512*sizeof(int16_t)=1024
     }
@@ -276,68 +329,431 @@ void AudioCapture::processAudioData()
     }
 
     try{
-        // rawData 是 int16_t PCM，16kHz单通道
-        int numSamples = rawData.size() / sizeof(int16_t);
-        const int16_t* pcm = reinterpret_cast<const int16_t*>(rawData.constData());
-        std::vector<float> floatSamples(numSamples);
-        for (int i = 0; i < numSamples; ++i) {
-            floatSamples[i] = pcm[i] / 32768.0f; // int16 -> float [-1, 1]
-        }
+        // rawData 是 int16_t PCM，16kHz单通道，直接送入 VAD
+        feedVad(rawData, false);
 
-        // 直接送入 VAD
-        SherpaOnnxVoiceActivityDetectorAcceptWaveform(vad, floatSamples.data(), numSamples);
-        // qDebug() << "TEST: " << !SherpaOnnxVoiceActivityDetectorEmpty(vad);
+        m_audioQueue.enqueue(rawData);
+        m_totalBytesProcessed += rawData.size(); // 更新总字节数
 
-        while (!SherpaOnnxVoiceActivityDetectorEmpty(vad)) {
-            const SherpaOnnxSpeechSegment *segment =
-                SherpaOnnxVoiceActivityDetectorFront(vad);
+        // // 调试输出
+        // qDebug() << "Processed chunk:" << rawData.size() << "bytes"
+        //          << "Total:" << m_totalBytesProcessed << "bytes";
+    }
+    catch (const std::exception& e) {
+        qDebug() << "Exception in VAD processing:" << e.what();
+        return;
+    }
+}
 
-            float start = segment->start / 16000.0f;
-            float duration = segment->n / 16000.0f;
-            float stop = start + duration;
+void AudioCapture::replayAudioData()
+{
+    // 按墙上时间计算当前应当到达的采样数，定时器抖动时一次补送多块
+    const size_t chunkSamples = sampleRate * kBufferDurationMs / 1000;
+    const size_t due = qMin<size_t>(m_replayClock.elapsed() * sampleRate / 1000,
+                                    m_replaySamples.size());
 
-            if (recognizer == NULL) {
-                fprintf(stderr, "Please check your config!\n");
+    try{
+        while (m_replayPos < due) {
+            const size_t n = qMin(chunkSamples, m_replaySamples.size() - m_replayPos);
+            if (m_replayPos + n > due && m_replayPos + n < m_replaySamples.size()) {
+                break;
             }
-            else {
-                const SherpaOnnxOfflineStream *stream =
-                    SherpaOnnxCreateOfflineStream(recognizer);
-
-                try{
-                    SherpaOnnxAcceptWaveformOffline(stream, sampleRate, segment->samples,
-                                                    segment->n);
-                    SherpaOnnxDecodeOfflineStream(recognizer, stream);
-                    const SherpaOnnxOfflineRecognizerResult *result = SherpaOnnxGetOfflineStreamResult(stream);
-
-                    auto tmp = VoiceData(std::make_pair(start, stop), result->text);
-                    emit voiceDataSend(tmp);
-                    voiceData.append(tmp);
-                    // QString context = QString("%1-%2  Decoded text: %s").arg(start, 0, 'f', 3).arg(stop, 0, 'f', 3).arg(result->text);
-
-                    SherpaOnnxDestroyOfflineRecognizerResult(result);
-                }
-                catch (const std::exception& e) {
-                    qDebug() << "Exception in VAD processing:" << e.what();
-                }
 
-                SherpaOnnxDestroyOfflineStream(stream);
+            QByteArray rawData(static_cast<int>(n * sizeof(int16_t)), Qt::Uninitialized);
+            int16_t *pcm = reinterpret_cast<int16_t*>(rawData.data());
+            for (size_t i = 0; i < n; ++i) {
+                const float sample = qBound(-1.0f, m_replaySamples[m_replayPos + i], 1.0f);
+                pcm[i] = static_cast<int16_t>(sample * 32767.0f); // float [-1, 1] -> int16
             }
+            m_replayPos += n;
 
-
-            SherpaOnnxDestroySpeechSegment(segment);
-            SherpaOnnxVoiceActivityDetectorPop(vad);
+            TraceScope chunkTrace("replay_chunk", rawData.size());
+            feedVad(rawData, m_replayPos >= m_replaySamples.size());
+            m_totalBytesProcessed += rawData.size();
         }
-        m_audioQueue.enqueue(rawData);
-        m_totalBytesProcessed += rawData.size(); // 更新总字节数
+    }
+    catch (const std::exception& e) {
+        qDebug() << "Exception in VAD processing:" << e.what();
+    }
 
-        // // 调试输出
-        // qDebug() << "Processed chunk:" << rawData.size() << "bytes"
-        //          << "Total:" << m_totalBytesProcessed << "bytes";
+    if (m_replayPos >= m_replaySamples.size()) {
+        m_timer->stop();
+        m_replaySamples.clear();
+        m_replayPos = 0;
+        m_finishPending = true;
+        finishIfDrained();
+    }
+}
+
+void AudioCapture::processFileData()
+{
+    // 每次定时器触发处理一段文件数据，不按实时速度，也不会长时间阻塞界面
+    const int32_t chunkFrames = m_fileReader->sampleRate() * kFileChunkMs / 1000;
+    std::vector<float> samples;
+
+    try{
+        for (int i = 0; i < kFileChunksPerTick && !m_fileReader->atEnd(); ++i) {
+            // 解码跟不上读文件时先不读，等下次定时器触发；否则排队的片段音频会占满内存
+            if (m_pendingDecodes >= kMaxPendingDecodes) break;
+            samples.clear();
+            TraceScope trace("file_chunk", chunkFrames);
+            const int32_t n = m_fileReader->read(samples, chunkFrames);
+            if (n == 0 && !m_fileReader->atEnd()) {
+                emit errorOccurred(m_fileReader->errorString());
+                break;
+            }
+            feedVad(samples.data(), n, m_fileReader->atEnd());
+        }
     }
     catch (const std::exception& e) {
         qDebug() << "Exception in VAD processing:" << e.what();
+    }
+
+    if (m_fileReader->atEnd() || !m_fileReader->errorString().isEmpty()) {
+        m_timer->stop();
+        delete m_fileReader;
+        m_fileReader = nullptr;
+        m_finishPending = true;
+        finishIfDrained();
+    }
+}
+
+void AudioCapture::feedVad(const QByteArray &pcmData, bool flush)
+{
+    int numSamples = pcmData.size() / sizeof(int16_t);
+    const int16_t* pcm = reinterpret_cast<const int16_t*>(pcmData.constData());
+
+    // 同时保留一份历史数据，用于语音未结束时提前切分解码
+    const size_t historySize = m_speechHistory.size();
+    m_speechHistory.resize(historySize + numSamples);
+    float *floatSamples = m_speechHistory.data() + historySize;
+    for (int i = 0; i < numSamples; ++i) {
+        floatSamples[i] = pcm[i] / 32768.0f; // int16 -> float [-1, 1]
+    }
+
+    acceptHistoryTail(numSamples, flush);
+}
+
+void AudioCapture::feedVad(const float *samples, int32_t numSamples, bool flush)
+{
+    m_speechHistory.insert(m_speechHistory.end(), samples, samples + numSamples);
+    acceptHistoryTail(numSamples, flush);
+}
+
+void AudioCapture::acceptHistoryTail(int32_t numSamples, bool flush)
+{
+    const float *floatSamples = m_speechHistory.data() + m_speechHistory.size() - numSamples;
+
+    {
+        TraceScope trace("vad_accept", numSamples);
+        if (numSamples > 0) {
+            SherpaOnnxVoiceActivityDetectorAcceptWaveform(vad, floatSamples, numSamples);
+        }
+        m_samplesFed += numSamples;
+
+        if (flush) {
+            SherpaOnnxVoiceActivityDetectorFlush(vad);
+        }
+    }
+
+    // 先取出已结束的片段：一块数据可能同时结束上一句、开始下一句，
+    // 若先提前切分，会把下一句开头的音频算进上一句
+    const bool segmentClosed = decodeSegments();
+
+    const bool detected = !flush && SherpaOnnxVoiceActivityDetectorDetected(vad);
+    if (detected && (!m_speechActive || segmentClosed)) {
+        // VAD 确认语音时已经过了 min_speech_duration，往前回溯估计语音起点。
+        // 估计宁早勿晚：起点晚于 VAD 片段起点时，开头没被提前解码覆盖，只能单独解码一小段，
+        // 会把第一个音节切开；早一点只是多带一段静音，历史数据里有足够的前导
+        const qint64 minSpeechSamples =
+            static_cast<qint64>(vadConfig.silero_vad.min_speech_duration * sampleRate);
+        const qint64 marginSamples = static_cast<qint64>(kOnsetMarginSeconds * sampleRate);
+        const qint64 onset = m_samplesFed - numSamples - minSpeechSamples
+                             - 2 * vadConfig.silero_vad.window_size - marginSamples;
+        m_speechCursor = qMax(qMax(onset, m_historyStart), m_emittedUntil);
+    }
+    m_speechActive = detected;
+
+    if (m_speechActive) {
+        decodeEarlyPieces();
+    }
+
+    // 裁剪历史数据：语音中保留未解码部分，静音时只保留一小段前导数据
+    const qint64 preRoll = static_cast<qint64>(kSplitPreRollSeconds * sampleRate);
+    qint64 keepFrom = m_samplesFed - preRoll;
+    if (m_speechActive) {
+        keepFrom = qMin(keepFrom, m_speechCursor);
+    }
+    if (keepFrom - m_historyStart > preRoll) {
+        m_speechHistory.erase(m_speechHistory.begin(),
+                              m_speechHistory.begin() + (keepFrom - m_historyStart));
+        m_historyStart = keepFrom;
+    }
+}
+
+void AudioCapture::decodeEarlyPieces()
+{
+    if (recognizer == NULL) return;
+
+    const float *history = m_speechHistory.data();
+    const int32_t n = static_cast<int32_t>(m_samplesFed - m_historyStart);
+    int32_t cursor = static_cast<int32_t>(qMax(m_speechCursor, m_historyStart) - m_historyStart);
+
+    std::vector<std::pair<int32_t, int32_t>> pieces;
+    int32_t cut = m_splitter.nextCut(history, cursor, n);
+    while (cut > cursor) {
+        pieces.emplace_back(cursor, cut);
+        cursor = cut;
+        cut = m_splitter.nextCut(history, cursor, n);
+    }
+
+    if (pieces.empty()) return;
+
+    TraceScope trace("early_pieces", static_cast<qint64>(pieces.size()));
+    // 说话人还没说完，先把已经够长的部分解码发送，之后的部分拼接到同一条结果上
+    const qint64 id = currentUtterance();
+    decodePieces(history, m_historyStart, pieces, id);
+    m_emittedUntil = m_historyStart + cursor;
+    m_speechCursor = m_emittedUntil;
+}
+
+bool AudioCapture::decodeSegments()
+{
+    bool popped = false;
+    while (!SherpaOnnxVoiceActivityDetectorEmpty(vad)) {
+        TraceScope trace("segment_pop");
+        const SherpaOnnxSpeechSegment *segment =
+            SherpaOnnxVoiceActivityDetectorFront(vad);
+        trace.setValue(segment->n);
+
+        const qint64 segmentStart = segment->start;
+        const qint64 segmentEnd = segmentStart + segment->n;
+
+        if (recognizer == NULL) {
+            fprintf(stderr, "Please check your config!\n");
+        }
+        else {
+            const qint64 id = currentUtterance();
+            try{
+                // 跳过已经提前解码发送的部分，剩余部分按低能量点切分后批量解码
+                const int32_t skip = static_cast<int32_t>(
+                    qBound<qint64>(0, m_emittedUntil - segmentStart, segment->n));
+                if (skip < segment->n) {
+                    auto pieces = m_splitter.split(segment->samples + skip, segment->n - skip);
+                    for (auto &piece : pieces) {
+                        piece.first += skip;
+                        piece.second += skip;
+                    }
+                    if (!pieces.empty()) {
+                        decodePieces(segment->samples, segmentStart, pieces, id);
+                    }
+                }
+            }
+            catch (const std::exception& e) {
+                qDebug() << "Exception in VAD processing:" << e.what();
+            }
+
+            // 说话人向量在工作线程上与解码同时计算；每句话只用整段语音算一次，
+            // 同一行不会收到多个先后不定的说话人结果
+            if (m_diarizer) {
+                m_diarizer->submit(id, segment->samples, segment->n);
+            }
+            closeUtterance();
+        }
+
+        m_emittedUntil = qMax(m_emittedUntil, segmentEnd);
+        m_speechCursor = qMax(m_speechCursor, segmentEnd);
+
+        SherpaOnnxDestroySpeechSegment(segment);
+        SherpaOnnxVoiceActivityDetectorPop(vad);
+        popped = true;
+    }
+    return popped;
+}
+
+void AudioCapture::decodePieces(const float *samples, qint64 firstSample,
+                                const std::vector<std::pair<int32_t, int32_t>> &pieces, qint64 id)
+{
+    const int32_t begin = pieces.front().first;
+    const int32_t end = pieces.back().second;
+
+    // 历史数据随后会被裁剪，复制一份交给解码线程，片段位置改为相对于副本
+    std::vector<float> copy(samples + begin, samples + end);
+    std::vector<std::pair<int32_t, int32_t>> rebased;
+    rebased.reserve(pieces.size());
+    for (const auto &piece : pieces) {
+        rebased.emplace_back(piece.first - begin, piece.second - begin);
+    }
+
+    const qint64 partStart = firstSample + begin;
+    const std::pair<float, float> time((partStart - m_timeBase) / 16000.0f,
+                                       (firstSample + end - m_timeBase) / 16000.0f);
+    // 片段结束时刻：当前时间减去其后已送入的音频时长
+    const qint64 endNs = PipelineTrace::nowNs()
+                         - (m_samplesFed - firstSample - end) * 1000000000LL / sampleRate;
+
+    ++m_pendingDecodes;
+    ++m_utterances[id].pending;
+    DecodeScheduler::instance().submit(
+        m_decodeSession, std::move(copy), std::move(rebased), endNs,
+        [this, id, partStart, time](const DecodeScheduler::Result &result) {
+            // 在解码线程上调用，转回本对象所在线程；本对象销毁后不会再执行
+            QMetaObject::invokeMethod(this, [this, id, partStart, time, result]() {
+                onDecoded(id, partStart, time, result);
+            }, Qt::QueuedConnection);
+        });
+}
+
+qint64 AudioCapture::currentUtterance()
+{
+    if (m_utteranceId < 0) {
+        m_utteranceId = g_nextVoiceId++;
+        m_utterances.insert(m_utteranceId, Utterance());
+    }
+    return m_utteranceId;
+}
+
+void AudioCapture::closeUtterance()
+{
+    if (m_utteranceId < 0) return;
+
+    Utterance &utterance = m_utterances[m_utteranceId];
+    utterance.closed = true;
+    if (utterance.pending == 0) {
+        finishUtterance(m_utteranceId);
+    }
+    m_utteranceId = -1;
+}
+
+void AudioCapture::finishUtterance(qint64 id)
+{
+    // 整句文本到齐后再加标点
+    m_utterances.remove(id);
+    VoiceData *data = findVoiceData(id);
+    if (m_punctuation && data) {
+        m_punctuation->submit(id, data->context);
+    }
+}
+
+void AudioCapture::onDecoded(qint64 id, qint64 partStart, const std::pair<float, float> &time,
+                             const DecodeScheduler::Result &result)
+{
+    --m_pendingDecodes;
+
+    auto it = m_utterances.find(id);
+    if (it == m_utterances.end()) {
+        finishIfDrained();
         return;
     }
+    Utterance &utterance = *it;
+    --utterance.pending;
+    if (utterance.parts.empty()) {
+        utterance.time = time;
+    } else {
+        utterance.time.first = qMin(utterance.time.first, time.first);
+        utterance.time.second = qMax(utterance.time.second, time.second);
+    }
+    utterance.parts[partStart] = result.text;
+
+    // 各部分可能乱序返回，按起点顺序重新拼接
+    QString text;
+    for (const auto &part : utterance.parts) {
+        appendTranscript(text, part.second);
+    }
+
+    if (VoiceData *data = findVoiceData(id)) {
+        data->time = utterance.time;
+        data->context = text;
+        emit voiceDataUpdated(*data);
+    } else {
+        auto tmp = VoiceData(utterance.time, text);
+        tmp.id = id;
+        tmp.speaker = m_pendingSpeakers.take(id);
+
+        // 调度可能让后面的短片段先完成，按序号插入以保持 voiceData 有序
+        auto pos = voiceData.end();
+        while (pos != voiceData.begin() && (pos - 1)->id > id) {
+            --pos;
+        }
+        voiceData.insert(pos, tmp);
+        emit voiceDataSend(tmp);
+    }
+
+    qDebug() << QString("Decoded [%1-%2] after %3 ms in queue, %4 ms decoding%5")
+                    .arg(time.first, 0, 'f', 2)
+                    .arg(time.second, 0, 'f', 2)
+                    .arg(result.queueNs / 1000000)
+                    .arg(result.decodeNs / 1000000)
+                    .arg(result.missedDeadline ? ", deadline missed" : "");
+
+    if (utterance.closed && utterance.pending == 0) {
+        finishUtterance(id);
+    }
+    finishIfDrained();
+}
+
+void AudioCapture::finishIfDrained()
+{
+    if (m_finishPending && m_pendingDecodes == 0) {
+        m_finishPending = false;
+        setActive(false);
+        emit replayFinished();
+    }
+}
+
+void AudioCapture::resetStream()
+{
+    // 中途停止的文件或回放可能留下未结束的语音，不能带进下一次采集：
+    // 结束当前这句话，清空 VAD 和历史数据，下一次从新的位置开始
+    closeUtterance();
+    if (vad) {
+        SherpaOnnxVoiceActivityDetectorReset(vad);
+    }
+    m_speechHistory.clear();
+    m_historyStart = m_samplesFed;
+    m_speechCursor = m_samplesFed;
+    m_emittedUntil = m_samplesFed;
+    m_speechActive = false;
+}
+
+void AudioCapture::setActive(bool active)
+{
+    if (active == m_active) return;
+    m_active = active;
+    if (active) {
+        RecognizerCalibration::captureStarted();
+    } else {
+        RecognizerCalibration::captureStopped();
+    }
+}
+
+VoiceData *AudioCapture::findVoiceData(qint64 id)
+{
+    // 结果按序号递增追加，从后往前找
+    for (auto it = voiceData.rbegin(); it != voiceData.rend(); ++it) {
+        if (it->id == id) return &*it;
+        if (it->id < id) break;
+    }
+    return nullptr;
+}
+
+void AudioCapture::onSpeakerAssigned(qint64 id, const QString &label)
+{
+    if (VoiceData *data = findVoiceData(id)) {
+        data->speaker = label;
+        emit voiceDataUpdated(*data);
+    } else if (m_utterances.contains(id)) {
+        // 识别结果还在解码队列中
+        m_pendingSpeakers.insert(id, label);
+    }
+}
+
+void AudioCapture::onPunctuated(qint64 id, const QString &text)
+{
+    if (VoiceData *data = findVoiceData(id)) {
+        data->context = text;
+        emit voiceDataUpdated(*data);
+    }
 }
 
 QByteArray AudioCapture::resampleTo16kHzMono(const QByteArray &input, const QAudioFormat &format)
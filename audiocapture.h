@@ -9,32 +9,73 @@
 #include <QFile>
 #include <QTimer>
 #include <QAudioDevice>
+#include <QElapsedTimer>
+#include <QHash>
 #include <c-api.h>
 
+#include <map>
+#include <optional>
+
+#include "speechsplitter.h"
+#include "decodescheduler.h"
+#include "recognizerprofile.h"
+
+class SpeakerDiarizer;
+class PunctuationWorker;
+class AudioFileReader;
+
 class VoiceData{
 public:
     std::pair<float, float> time;
     QString context;
+    qint64 id = -1;   // 进程内递增的序号，各采集实例不重复，用于排序和之后更新已显示的结果
+    QString speaker;  // 说话人标签，异步计算，可能在首次发送之后才填入
     VoiceData(const std::pair<float, float>& t, const QString& c) : time(t), context(c) {}
 };
 
+// 拼接两段识别文本，中英混合时避免两个英文单词粘在一起
+void appendTranscript(QString &text, const QString &piece);
+
+// 采集流水线的可调参数
+struct CaptureSettings
+{
+    float minSilenceDuration = 0.2f; // VAD 最小静音持续时间（秒）
+    int32_t windowSize = 512;        // VAD 分析窗口大小（采样点数）
+    int32_t numThreads = 0;          // 识别模型线程数，0 表示使用校准结果
+    bool diarization = true;         // 说话人分离，模型不存在时自动关闭
+    bool punctuation = true;         // 异步标点，模型不存在时自动关闭
+    bool interactive = true;         // 交互会话的片段优先解码；文件转写总是按非交互处理
+    float decodeSloSeconds = 1.0f;   // 片段结束到文本发出的目标延迟（秒），决定解码截止时间
+    std::optional<RecognizerProfile> profile;  // 指定识别器配置；不指定时使用当前校准结果
+};
+
 class AudioCapture : public QObject
 {
     Q_OBJECT
 public:
     explicit AudioCapture(QObject *parent = nullptr);
+    explicit AudioCapture(const CaptureSettings &settings, QObject *parent = nullptr);
     ~AudioCapture();
 
     void startCapture();
     void stopCapture();
+    // 以实时速度回放 16kHz 单声道音频，走与麦克风相同的处理路径
+    void startReplay(const std::vector<float> &samples);
+    // 流式解码 WAV / 原始 PCM 文件，可从 offsetSeconds 处开始；全部片段解码完成后发出 replayFinished
+    bool startFile(const QString &path, double offsetSeconds = 0.0);
     QVector<VoiceData> voiceData;
 
 public:signals:
     void errorOccurred(const QString &message);
     void voiceDataSend(const VoiceData& data);
+    void replayFinished();
+    // 已发送的结果被补充了信息（例如说话人标签）
+    void voiceDataUpdated(const VoiceData& data);
 
 private slots:
     void processAudioData();
+    void onSpeakerAssigned(qint64 id, const QString &label);
+    void onPunctuated(qint64 id, const QString &text);
 
 private:
     QAudioSource *m_audioSource = nullptr;
@@ -50,6 +91,26 @@ private:
     void writeWavFile();
     void processRemainingData();
 
+    void replayAudioData();
+    VoiceData *findVoiceData(qint64 id);
+    void processFileData();
+    void feedVad(const QByteArray &pcmData, bool flush);
+    void feedVad(const float *samples, int32_t numSamples, bool flush);
+    void acceptHistoryTail(int32_t numSamples, bool flush);
+    void decodeEarlyPieces();
+    // 取出并解码 VAD 已结束的片段，返回是否有片段结束
+    bool decodeSegments();
+    void decodePieces(const float *samples, qint64 firstSample,
+                      const std::vector<std::pair<int32_t, int32_t>> &pieces, qint64 id);
+    void onDecoded(qint64 id, qint64 partStart, const std::pair<float, float> &time,
+                   const DecodeScheduler::Result &result);
+    qint64 currentUtterance();
+    void closeUtterance();
+    void finishUtterance(qint64 id);
+    void finishIfDrained();
+    void resetStream();
+    void setActive(bool active);
+
 
 
     QByteArray fixedHeader; // 存储除dataSize外的固定头部数据
@@ -60,16 +121,20 @@ private:
     std::vector<float> vadBuffer;  // 缓存用于VAD的浮点数据
 
     // Vad
-    const SherpaOnnxVoiceActivityDetector *vad;
+    const SherpaOnnxVoiceActivityDetector *vad = nullptr;
     SherpaOnnxVadModelConfig vadConfig;
     const char *vad_filename;
     int32_t use_silero_vad = 0;
     int32_t use_ten_vad = 0;
 
 
-    SherpaOnnxOfflineParaformerModelConfig paraformer_config;
-    SherpaOnnxOfflineModelConfig offline_model_config;
     const SherpaOnnxOfflineRecognizer *recognizer;
+    // 解码在共享的调度线程上进行，结果异步返回
+    int m_decodeSession = -1;
+    bool m_interactive = true;
+    int m_pendingDecodes = 0;      // 已提交但结果尚未返回的片段数
+    bool m_finishPending = false;  // 回放/文件已读完，等待剩余片段解码完成后发出 replayFinished
+    bool m_active = false;         // 正在采集或解码，期间后台校准暂停
 
 
     const int sampleRate = 16000;
@@ -79,6 +144,53 @@ private:
     const int blockAlign = channels * bitsPerSample / 8;
     // 计算32ms音频数据所需字节数（使用实际采样率）
     const int kBufferDurationMs = 32;
+
+    // 长语音切分：按目标长度在低能量点切开，切出的片段批量解码
+    const float kSplitTargetSeconds = 3.0f;   // 目标片段长度（秒）
+    const float kSplitSearchSeconds = 0.8f;   // 在目标点前后搜索最安静点的范围（秒）
+    const int kSplitWindowMs = 20;            // 短时能量窗口（毫秒）
+    const float kSplitPreRollSeconds = 1.0f;  // 静音时保留的前导数据（秒）
+    const float kOnsetMarginSeconds = 0.1f;   // 估计语音起点时额外往前留的余量（秒）
+    SpeechSplitter m_splitter{static_cast<int32_t>(kSplitTargetSeconds * sampleRate),
+                              static_cast<int32_t>(kSplitSearchSeconds * sampleRate),
+                              sampleRate * kSplitWindowMs / 1000};
+
+    std::vector<float> m_speechHistory;  // 最近送入VAD的数据，用于语音未结束时提前解码
+    qint64 m_historyStart = 0;           // m_speechHistory[0] 对应的绝对采样位置
+    qint64 m_samplesFed = 0;             // 已送入VAD的总采样数
+    qint64 m_speechCursor = 0;           // 下一个提前解码片段的起点（绝对采样位置）
+    qint64 m_emittedUntil = 0;           // 已解码发送到的绝对采样位置
+    qint64 m_timeBase = 0;               // 本次采集起点的绝对采样位置，时间戳相对于它
+    bool m_speechActive = false;
+
+    // 说话人分离，与识别并行
+    SpeakerDiarizer *m_diarizer = nullptr;
+    // 标点，识别文本先原样发送，之后再更新
+    PunctuationWorker *m_punctuation = nullptr;
+
+    // 一句话（一个 VAD 片段）对应一条 VoiceData；提前解码的各部分和最后的剩余部分
+    // 按起点顺序拼接到同一条结果上，通过 voiceDataUpdated 更新
+    struct Utterance
+    {
+        std::map<qint64, QString> parts;  // 起点（绝对采样位置） -> 文本
+        std::pair<float, float> time;
+        int pending = 0;                  // 尚未返回的解码部分
+        bool closed = false;              // VAD 片段已结束，不会再有新部分
+    };
+    QHash<qint64, Utterance> m_utterances;
+    qint64 m_utteranceId = -1;     // 正在进行的一句话，-1 表示没有
+    QHash<qint64, QString> m_pendingSpeakers;  // 说话人结果先于识别结果到达时暂存
+
+    // 文件回放
+    std::vector<float> m_replaySamples;
+    size_t m_replayPos = 0;
+    QElapsedTimer m_replayClock;
+
+    // 文件流式解码
+    AudioFileReader *m_fileReader = nullptr;
+    const int kFileChunkMs = 500;      // 每次读取的文件时长（毫秒）
+    const int kFileChunksPerTick = 8;  // 每次定时器触发最多处理的块数
+    const int kMaxPendingDecodes = 4;  // 解码积压达到该数时暂停读文件，内存不随文件长度增长
 };
 
 #endif // AUDIOCAPTURE_H
@@ -0,0 +1,232 @@
+#include "audiofilereader.h"
+
+#include <QtEndian>
+#include <QDebug>
+
+#include <cstring>
+
+AudioFileReader::~AudioFileReader()
+{
+    close();
+}
+
+bool AudioFileReader::open(const QString &path, int rawSampleRate, int rawChannels)
+{
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = QString("Failed to open %1: %2").arg(path, m_file.errorString());
+        return false;
+    }
+
+    const QByteArray magic = m_file.read(12);
+    if (magic.size() == 12 && magic.startsWith("RIFF") && magic.mid(8, 4) == "WAVE") {
+        if (!parseWavHeader()) {
+            close();
+            return false;
+        }
+    } else {
+        // 原始 PCM：16 位小端整数
+        m_format = 1;
+        m_sampleRate = rawSampleRate;
+        m_channels = rawChannels;
+        m_bitsPerSample = 16;
+        m_blockAlign = rawChannels * 2;
+        m_dataOffset = 0;
+        m_dataSize = m_file.size();
+    }
+
+    if (m_sampleRate <= 0 || m_channels <= 0 || m_blockAlign <= 0) {
+        m_error = QString("Invalid audio format in %1").arg(path);
+        close();
+        return false;
+    }
+
+    m_numFrames = m_dataSize / m_blockAlign;
+    m_frame = 0;
+
+    if (m_sampleRate != kOutputSampleRate) {
+        const float minFreq = qMin(m_sampleRate, kOutputSampleRate);
+        const float lowpassCutoff = 0.99f * 0.5f * minFreq;
+        m_resampler = SherpaOnnxCreateLinearResampler(m_sampleRate, kOutputSampleRate,
+                                                      lowpassCutoff, 6);
+    }
+    return true;
+}
+
+bool AudioFileReader::parseWavHeader()
+{
+    // 逐个遍历 RIFF 子块，找到 fmt 和 data
+    const qint64 fileSize = m_file.size();
+    qint64 pos = 12;
+    bool haveFormat = false;
+
+    while (pos + 8 <= fileSize) {
+        m_file.seek(pos);
+        const QByteArray chunkHeader = m_file.read(8);
+        if (chunkHeader.size() < 8) break;
+        const QByteArray id = chunkHeader.left(4);
+        const quint32 size = qFromLittleEndian<quint32>(chunkHeader.constData() + 4);
+
+        if (id == "fmt ") {
+            const QByteArray fmt = m_file.read(qMin<quint32>(size, 40));
+            if (fmt.size() < 16) break;
+            const char *p = fmt.constData();
+            m_format = qFromLittleEndian<quint16>(p);
+            m_channels = qFromLittleEndian<quint16>(p + 2);
+            m_sampleRate = static_cast<int>(qFromLittleEndian<quint32>(p + 4));
+            m_blockAlign = qFromLittleEndian<quint16>(p + 12);
+            m_bitsPerSample = qFromLittleEndian<quint16>(p + 14);
+            // WAVE_FORMAT_EXTENSIBLE：真实格式在子格式 GUID 的前两个字节
+            if (m_format == 0xFFFE && fmt.size() >= 26) {
+                m_format = qFromLittleEndian<quint16>(p + 24);
+            }
+            haveFormat = true;
+        } else if (id == "data") {
+            m_dataOffset = pos + 8;
+            // 录音中断的文件 data 大小可能是 0 或 0xFFFFFFFF，以实际文件长度为准
+            m_dataSize = qMin<qint64>(size, fileSize - m_dataOffset);
+            if (size == 0 || size == 0xFFFFFFFFu) {
+                m_dataSize = fileSize - m_dataOffset;
+            }
+            break;
+        }
+
+        pos += 8 + size + (size & 1);
+    }
+
+    if (!haveFormat || m_dataOffset == 0) {
+        m_error = QString("Missing fmt or data chunk in %1").arg(m_file.fileName());
+        return false;
+    }
+
+    const bool supported = (m_format == 1 && (m_bitsPerSample == 8 || m_bitsPerSample == 16
+                                              || m_bitsPerSample == 24 || m_bitsPerSample == 32))
+                           || (m_format == 3 && m_bitsPerSample == 32);
+    if (!supported) {
+        m_error = QString("Unsupported WAV format %1 with %2 bits").arg(m_format).arg(m_bitsPerSample);
+        return false;
+    }
+
+    // 转换时按 blockAlign 跨帧、按采样位宽读各声道，blockAlign 偏小会读到下一帧甚至越过映射区
+    if (m_blockAlign < m_channels * (m_bitsPerSample / 8)) {
+        m_error = QString("Invalid block align %1 for %2 channels of %3 bits")
+                      .arg(m_blockAlign).arg(m_channels).arg(m_bitsPerSample);
+        return false;
+    }
+    return true;
+}
+
+void AudioFileReader::close()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    m_mapOffset = 0;
+    m_mapSize = 0;
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+    if (m_resampler) {
+        SherpaOnnxDestroyLinearResampler(m_resampler);
+        m_resampler = nullptr;
+    }
+    m_numFrames = 0;
+    m_frame = 0;
+}
+
+bool AudioFileReader::seek(double seconds)
+{
+    if (!m_file.isOpen()) return false;
+
+    const qint64 frame = static_cast<qint64>(seconds * m_sampleRate);
+    if (frame < 0 || frame > m_numFrames) return false;
+
+    m_frame = frame;
+    if (m_resampler) {
+        SherpaOnnxLinearResamplerReset(m_resampler);
+    }
+    return true;
+}
+
+const uchar *AudioFileReader::mapFrames(qint64 frame, qint64 count)
+{
+    const qint64 begin = m_dataOffset + frame * m_blockAlign;
+    const qint64 end = begin + count * m_blockAlign;
+
+    if (!m_map || begin < m_mapOffset || end > m_mapOffset + m_mapSize) {
+        // 解除旧窗口后再映射新窗口，已读过的页不会留在内存里
+        if (m_map) {
+            m_file.unmap(m_map);
+            m_map = nullptr;
+        }
+        m_mapOffset = begin;
+        m_mapSize = qMin(qMax(kMapWindowBytes, end - begin), m_file.size() - begin);
+        m_map = m_file.map(m_mapOffset, m_mapSize);
+        if (!m_map) {
+            m_error = QString("Failed to map %1: %2").arg(m_file.fileName(), m_file.errorString());
+            return nullptr;
+        }
+    }
+    return m_map + (begin - m_mapOffset);
+}
+
+float AudioFileReader::sampleAt(const uchar *p) const
+{
+    if (m_format == 3) {
+        float value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    switch (m_bitsPerSample) {
+    case 8:
+        return (static_cast<int>(*p) - 128) / 128.0f;
+    case 16:
+        return qFromLittleEndian<qint16>(p) / 32768.0f;
+    case 24: {
+        // 放到 32 位的高 24 位上，符号位自然保留
+        const qint32 value = static_cast<qint32>((quint32(p[0]) << 8) | (quint32(p[1]) << 16)
+                                                 | (quint32(p[2]) << 24));
+        return value / 2147483648.0f;
+    }
+    default:
+        return qFromLittleEndian<qint32>(p) / 2147483648.0f;
+    }
+}
+
+int32_t AudioFileReader::read(std::vector<float> &out, int32_t maxFrames)
+{
+    if (!m_file.isOpen() || atEnd() || maxFrames <= 0) return 0;
+
+    const qint64 frames = qMin<qint64>(maxFrames, m_numFrames - m_frame);
+    const uchar *data = mapFrames(m_frame, frames);
+    if (!data) return 0;
+
+    // 多声道取平均转为单声道
+    const int bytesPerSample = m_bitsPerSample / 8;
+    m_mono.resize(static_cast<size_t>(frames));
+    for (qint64 i = 0; i < frames; ++i) {
+        const uchar *frame = data + i * m_blockAlign;
+        float sum = 0.0f;
+        for (int ch = 0; ch < m_channels; ++ch) {
+            sum += sampleAt(frame + ch * bytesPerSample);
+        }
+        m_mono[i] = sum / m_channels;
+    }
+    m_frame += frames;
+
+    if (!m_resampler) {
+        out.insert(out.end(), m_mono.begin(), m_mono.end());
+        return static_cast<int32_t>(frames);
+    }
+
+    const SherpaOnnxResampleOut *resampled = SherpaOnnxLinearResamplerResample(
+        m_resampler, m_mono.data(), static_cast<int32_t>(frames), atEnd() ? 1 : 0);
+    const int32_t n = resampled->n;
+    out.insert(out.end(), resampled->samples, resampled->samples + n);
+    SherpaOnnxLinearResamplerResampleFree(resampled);
+    return n;
+}
@@ -0,0 +1,67 @@
+#ifndef AUDIOFILEREADER_H
+#define AUDIOFILEREADER_H
+
+#include <QFile>
+#include <QString>
+#include <c-api.h>
+
+#include <vector>
+
+// 流式读取 WAV / 原始 PCM 文件，输出 16kHz 单声道 float
+// 文件按固定大小的窗口做内存映射，读完一段就解除映射，内存占用与文件大小无关
+class AudioFileReader
+{
+public:
+    AudioFileReader() = default;
+    ~AudioFileReader();
+
+    // 以 RIFF/WAVE 开头的按 WAV 解析，否则按 16 位小端原始 PCM 处理
+    // （asr_example_zh.pcm 这类文件），其采样率和声道数由 rawSampleRate / rawChannels 指定
+    bool open(const QString &path, int rawSampleRate = 16000, int rawChannels = 1);
+    void close();
+
+    // 跳到指定时间（秒）开始读取
+    bool seek(double seconds);
+
+    // 最多读取 maxFrames 个输入帧，转换后的 16kHz 单声道采样追加到 out，返回追加的采样数
+    int32_t read(std::vector<float> &out, int32_t maxFrames);
+
+    bool atEnd() const { return m_frame >= m_numFrames; }
+    double duration() const { return m_sampleRate > 0 ? double(m_numFrames) / m_sampleRate : 0.0; }
+    double position() const { return m_sampleRate > 0 ? double(m_frame) / m_sampleRate : 0.0; }
+    int sampleRate() const { return m_sampleRate; }
+    int channels() const { return m_channels; }
+    QString errorString() const { return m_error; }
+
+    AudioFileReader(const AudioFileReader &) = delete;
+    AudioFileReader &operator=(const AudioFileReader &) = delete;
+
+private:
+    bool parseWavHeader();
+    const uchar *mapFrames(qint64 frame, qint64 count);
+    float sampleAt(const uchar *p) const;
+
+    QFile m_file;
+    uchar *m_map = nullptr;
+    qint64 m_mapOffset = 0;
+    qint64 m_mapSize = 0;
+
+    qint64 m_dataOffset = 0;
+    qint64 m_dataSize = 0;
+    int m_format = 1;          // 1: 整数 PCM，3: IEEE float
+    int m_sampleRate = 0;
+    int m_channels = 0;
+    int m_bitsPerSample = 0;
+    int m_blockAlign = 0;
+    qint64 m_numFrames = 0;
+    qint64 m_frame = 0;
+
+    const SherpaOnnxLinearResampler *m_resampler = nullptr;
+    std::vector<float> m_mono;
+    QString m_error;
+
+    static constexpr qint64 kMapWindowBytes = 8 * 1024 * 1024;
+    static constexpr int kOutputSampleRate = 16000;
+};
+
+#endif // AUDIOFILEREADER_H
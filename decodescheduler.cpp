@@ -0,0 +1,236 @@
+#include "decodescheduler.h"
+#include "audiocapture.h"
+#include "pipelinetrace.h"
+
+#include <QDebug>
+
+#include <algorithm>
+
+DecodeScheduler &DecodeScheduler::instance()
+{
+    static DecodeScheduler scheduler;
+    return scheduler;
+}
+
+DecodeScheduler::DecodeScheduler()
+{
+    m_worker = std::thread(&DecodeScheduler::workerLoop, this);
+}
+
+DecodeScheduler::~DecodeScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_queueCondition.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+int DecodeScheduler::addSession(const SherpaOnnxOfflineRecognizer *recognizer, bool interactive,
+                                float sloSeconds)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const int session = m_nextSession++;
+    m_sessions[session] = Session{recognizer, interactive, static_cast<qint64>(sloSeconds * 1e9)};
+    return session;
+}
+
+void DecodeScheduler::setSessionInteractive(int session, bool interactive)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_sessions.find(session);
+    if (it != m_sessions.end()) {
+        it->second.interactive = interactive;
+    }
+}
+
+void DecodeScheduler::removeSession(int session)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_sessions.erase(session);
+    m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(),
+                                 [session](const Job &job) { return job.session == session; }),
+                  m_queue.end());
+    m_idleCondition.wait(lock, [this, session]() { return m_running != session; });
+}
+
+void DecodeScheduler::submit(int session, std::vector<float> &&samples,
+                             std::vector<std::pair<int32_t, int32_t>> &&pieces, qint64 endNs,
+                             Callback done)
+{
+    if (pieces.empty()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_sessions.find(session);
+        if (it == m_sessions.end()) return;
+        const Session &owner = it->second;
+
+        // 同一会话内截止时间与提交顺序一致，只按截止时间排就退化为先来先解；再按长短分类，
+        // 长句解码期间到达的短片段可以先解
+        const bool isShort = pieces.back().second - pieces.front().first <= kShortSamples;
+        Priority priority;
+        if (owner.interactive) {
+            priority = isShort ? Interactive : InteractiveLong;
+        } else {
+            priority = isShort ? Short : Bulk;
+        }
+
+        m_queue.push_back(Job{session, owner.recognizer, std::move(samples), std::move(pieces),
+                              priority, PipelineTrace::nowNs(), endNs + owner.sloNs,
+                              std::move(done)});
+    }
+    m_queueCondition.notify_one();
+}
+
+void DecodeScheduler::setPolicy(Policy policy)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_policy = policy;
+}
+
+DecodeScheduler::Policy DecodeScheduler::policy() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_policy;
+}
+
+DecodeScheduler::QueueStats DecodeScheduler::stats(Priority priority) const
+{
+    std::vector<qint64> queueNs;
+    QueueStats result;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const ClassStats &stats = m_stats[priority];
+        result.jobs = stats.jobs;
+        result.deadlineMisses = stats.deadlineMisses;
+        result.promoted = stats.promoted;
+        queueNs = stats.queueNs;
+    }
+
+    result.queueP50Ms = PipelineTrace::percentileMs(queueNs, 0.50);
+    result.queueP99Ms = PipelineTrace::percentileMs(queueNs, 0.99);
+    result.queueMaxMs = PipelineTrace::percentileMs(queueNs, 1.00);
+    return result;
+}
+
+void DecodeScheduler::resetStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (ClassStats &stats : m_stats) {
+        stats = ClassStats();
+    }
+}
+
+size_t DecodeScheduler::pickNext(qint64 now, bool *promoted) const
+{
+    *promoted = false;
+    if (m_policy == Fifo) return 0;
+
+    // 队列通常只有几个到几十个片段，线性扫描即可；等待时间随时变化，不适合用堆
+    size_t best = 0;
+    int bestClass = kNumPriorities;
+    for (size_t i = 0; i < m_queue.size(); ++i) {
+        const Job &job = m_queue[i];
+        const int jobClass = now - job.enqueueNs > kMaxWaitNs ? Interactive : job.priority;
+        if (jobClass < bestClass
+            || (jobClass == bestClass && job.deadlineNs < m_queue[best].deadlineNs)) {
+            best = i;
+            bestClass = jobClass;
+        }
+    }
+    *promoted = bestClass < m_queue[best].priority;
+    return best;
+}
+
+void DecodeScheduler::workerLoop()
+{
+    while (true) {
+        Job job;
+        qint64 startNs;
+        bool promoted;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_queueCondition.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+            if (m_stop) return;
+
+            startNs = PipelineTrace::nowNs();
+            const size_t index = pickNext(startNs, &promoted);
+            job = std::move(m_queue[index]);
+            m_queue.erase(m_queue.begin() + index);
+            m_running = job.session;
+        }
+
+        if (PipelineTrace::isEnabled()) {
+            PipelineTrace::record("decode_wait", job.enqueueNs, startNs - job.enqueueNs,
+                                  job.priority);
+        }
+
+        Result result;
+        try{
+            result.text = decode(job);
+        }
+        catch (const std::exception& e) {
+            qDebug() << "Exception in decoding:" << e.what();
+        }
+
+        const qint64 finishNs = PipelineTrace::nowNs();
+        result.queueNs = startNs - job.enqueueNs;
+        result.decodeNs = finishNs - startNs;
+        result.missedDeadline = finishNs > job.deadlineNs;
+
+        // 回调在 m_running 清除之前执行，removeSession 返回后不会再有该会话的回调
+        job.done(result);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = -1;
+
+            ClassStats &stats = m_stats[job.priority];
+            if (stats.queueNs.size() < kStatsWindow) {
+                stats.queueNs.push_back(result.queueNs);
+            } else {
+                stats.queueNs[stats.jobs % kStatsWindow] = result.queueNs;
+            }
+            ++stats.jobs;
+            if (result.missedDeadline) ++stats.deadlineMisses;
+            if (promoted) ++stats.promoted;
+        }
+        m_idleCondition.notify_all();
+    }
+}
+
+QString DecodeScheduler::decode(const Job &job) const
+{
+    std::vector<const SherpaOnnxOfflineStream *> streams;
+    streams.reserve(job.pieces.size());
+    {
+        TraceScope trace("create_streams", static_cast<qint64>(job.pieces.size()));
+        for (const auto &piece : job.pieces) {
+            const SherpaOnnxOfflineStream *stream = SherpaOnnxCreateOfflineStream(job.recognizer);
+            SherpaOnnxAcceptWaveformOffline(stream, 16000, job.samples.data() + piece.first,
+                                            piece.second - piece.first);
+            streams.push_back(stream);
+        }
+    }
+
+    // 多个片段一次批量解码，由 sherpa-onnx 内部并行
+    {
+        TraceScope trace("decode", job.pieces.back().second - job.pieces.front().first);
+        SherpaOnnxDecodeMultipleOfflineStreams(job.recognizer, streams.data(),
+                                               static_cast<int32_t>(streams.size()));
+    }
+
+    // 按顺序拼接各片段文本
+    QString text;
+    for (const SherpaOnnxOfflineStream *stream : streams) {
+        const SherpaOnnxOfflineRecognizerResult *result = SherpaOnnxGetOfflineStreamResult(stream);
+        appendTranscript(text, QString::fromUtf8(result->text));
+        SherpaOnnxDestroyOfflineRecognizerResult(result);
+        SherpaOnnxDestroyOfflineStream(stream);
+    }
+    return text;
+}
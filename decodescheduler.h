@@ -0,0 +1,132 @@
+#ifndef DECODESCHEDULER_H
+#define DECODESCHEDULER_H
+
+#include <QString>
+#include <c-api.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// 识别解码调度：所有采集会话共用一个解码线程
+// 积压的片段不再先来先解，而是先按会话是否交互、片段长短分类，同类内按截止时间最早优先（EDF）；
+// 截止时间 = 片段结束时刻 + 会话的延迟目标（SLO）。等待过久的片段提升到最高类，避免饿死。
+class DecodeScheduler
+{
+public:
+    enum Priority {
+        Interactive = 0,      // 交互会话（麦克风、实时回放）的短片段，包括提前切分的部分
+        InteractiveLong = 1,  // 交互会话的长片段，不挡在同一会话的短片段前面
+        Short = 2,            // 非交互会话中的短片段
+        Bulk = 3,             // 其余片段，例如文件转写中的长句
+        kNumPriorities
+    };
+
+    enum Policy {
+        Fifo,      // 按提交顺序解码，用于对比
+        Deadline,  // 优先级 + EDF
+    };
+
+    struct Result
+    {
+        QString text;
+        qint64 queueNs = 0;   // 提交到开始解码的等待时间
+        qint64 decodeNs = 0;
+        bool missedDeadline = false;
+    };
+    // 在解码线程上调用，应尽快把结果转交回所属线程
+    using Callback = std::function<void(const Result &)>;
+
+    struct QueueStats
+    {
+        qint64 jobs = 0;
+        qint64 deadlineMisses = 0;
+        qint64 promoted = 0;  // 因等待过久被提升的片段数
+        // 没有片段时为 NaN
+        double queueP50Ms = 0.0;
+        double queueP99Ms = 0.0;
+        double queueMaxMs = 0.0;
+    };
+
+    static DecodeScheduler &instance();
+
+    // 返回会话号；sloSeconds 为片段结束到文本发出的目标延迟
+    int addSession(const SherpaOnnxOfflineRecognizer *recognizer, bool interactive,
+                   float sloSeconds);
+    void setSessionInteractive(int session, bool interactive);
+    // 丢弃该会话排队中的片段并等待正在解码的片段完成，之后可以安全销毁识别器
+    void removeSession(int session);
+
+    // samples 为要解码的音频，pieces 为其中各个切分片段的 [begin, end)，一次批量解码后按顺序拼接文本
+    // endNs 为片段最后一个采样被采集到的时刻（PipelineTrace::nowNs 时钟）
+    void submit(int session, std::vector<float> &&samples,
+                std::vector<std::pair<int32_t, int32_t>> &&pieces, qint64 endNs,
+                Callback done);
+
+    void setPolicy(Policy policy);
+    Policy policy() const;
+
+    QueueStats stats(Priority priority) const;
+    void resetStats();
+
+    DecodeScheduler(const DecodeScheduler &) = delete;
+    DecodeScheduler &operator=(const DecodeScheduler &) = delete;
+
+private:
+    DecodeScheduler();
+    ~DecodeScheduler();
+
+    struct Session
+    {
+        const SherpaOnnxOfflineRecognizer *recognizer;
+        bool interactive;
+        qint64 sloNs;
+    };
+
+    struct Job
+    {
+        int session;
+        const SherpaOnnxOfflineRecognizer *recognizer;
+        std::vector<float> samples;
+        std::vector<std::pair<int32_t, int32_t>> pieces;
+        Priority priority;
+        qint64 enqueueNs;
+        qint64 deadlineNs;
+        Callback done;
+    };
+
+    struct ClassStats
+    {
+        qint64 jobs = 0;
+        qint64 deadlineMisses = 0;
+        qint64 promoted = 0;
+        std::vector<qint64> queueNs;  // 最近 kStatsWindow 个片段的等待时间，环形覆盖
+    };
+
+    void workerLoop();
+    size_t pickNext(qint64 now, bool *promoted) const;
+    QString decode(const Job &job) const;
+
+    std::thread m_worker;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_queueCondition;
+    std::condition_variable m_idleCondition;
+    std::vector<Job> m_queue;  // 按提交顺序存放，出队时扫描选择
+    bool m_stop = false;
+    int m_running = -1;        // 正在解码的会话号
+
+    std::unordered_map<int, Session> m_sessions;
+    int m_nextSession = 0;
+    Policy m_policy = Deadline;
+    ClassStats m_stats[kNumPriorities];
+
+    static constexpr qint64 kShortSamples = 2 * 16000;           // 短片段上限（2 秒）
+    static constexpr qint64 kMaxWaitNs = 2000LL * 1000 * 1000;  // 等待超过 2 秒提升到最高类
+    static constexpr size_t kStatsWindow = 4096;
+};
+
+#endif // DECODESCHEDULER_H
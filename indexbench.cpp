@@ -0,0 +1,120 @@
+#include "indexbench.h"
+#include "transcriptindex.h"
+#include "pipelinetrace.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+// 按 1/(排名+3) 的 Zipf 分布从 5000 个汉字中取字：最高频字约占 4.6%，
+// 与现代汉语中“的”约 4% 的占比相当
+const int kVocabulary = 5000;
+const int kZipfOffset = 3;
+const char16_t kFirstHan = 0x4E00;
+
+} // namespace
+
+int runIndexBench(const QStringList &arguments)
+{
+    int segments = 500000;
+    int queries = 1000;
+    for (const QString &argument : arguments) {
+        if (argument.startsWith("--segments=")) segments = qMax(1, argument.section('=', 1).toInt());
+        if (argument.startsWith("--queries=")) queries = qMax(1, argument.section('=', 1).toInt());
+    }
+
+    std::mt19937 rng(42);
+    std::vector<double> weights(kVocabulary);
+    for (int i = 0; i < kVocabulary; ++i) {
+        weights[i] = 1.0 / (i + kZipfOffset);
+    }
+    std::discrete_distribution<int> charDist(weights.begin(), weights.end());
+    std::uniform_int_distribution<int> lengthDist(8, 40);
+
+    // 保留一部分文本用于抽取一定能命中的查询
+    std::vector<QString> samples;
+    TranscriptIndex index;
+    QElapsedTimer timer;
+    qint64 addNs = 0;
+    for (int i = 0; i < segments; ++i) {
+        QString text;
+        const int length = lengthDist(rng);
+        for (int k = 0; k < length; ++k) {
+            text.append(QChar(static_cast<char16_t>(kFirstHan + charDist(rng))));
+        }
+        VoiceData data(std::make_pair(i * 3.0f, i * 3.0f + 2.5f), text);
+        data.id = i;
+
+        timer.start();
+        index.add(data);
+        addNs += timer.nsecsElapsed();
+
+        if (i % qMax(1, segments / 4096) == 0) {
+            samples.push_back(text);
+        }
+    }
+
+    qInfo().noquote() << QString("Indexed %1 segments in %2 ms (%3 us/segment), %4 MB")
+                             .arg(index.size())
+                             .arg(addNs / 1e6, 0, 'f', 1)
+                             .arg(addNs / 1e3 / segments, 0, 'f', 2)
+                             .arg(index.memoryUsage() / 1048576.0, 0, 'f', 1);
+
+    // 窗口程序在 Windows 上没有控制台，结果同时写入 CSV
+    QStringList reportLines;
+    reportLines.append("segments,index_ms,memory_mb,query_length,queries,hits_avg,"
+                       "p50_us,p99_us,max_us");
+    qInfo().noquote() << reportLines.front();
+
+    // 1 个字交替使用高频字（命中多）和低频字（命中少，逐段扫描时最慢）；其余长度从已索引文本中截取
+    std::uniform_int_distribution<size_t> sampleDist(0, samples.size() - 1);
+    for (int length : {1, 2, 4, 8}) {
+        std::vector<qint64> elapsed;
+        qint64 totalHits = 0;
+        for (int q = 0; q < queries; ++q) {
+            QString query;
+            if (length == 1) {
+                const int rank = q % 2 == 0 ? q % 8 : kVocabulary - 1 - q % 500;
+                query = QString(QChar(static_cast<char16_t>(kFirstHan + rank)));
+            } else {
+                const QString &text = samples[sampleDist(rng)];
+                std::uniform_int_distribution<int> offsetDist(0, text.size() - length);
+                query = text.mid(offsetDist(rng), length);
+            }
+
+            timer.start();
+            const QVector<TranscriptHit> hits = index.search(query);
+            elapsed.push_back(timer.nsecsElapsed());
+            totalHits += hits.size();
+        }
+
+        const QString line = QString("%1,%2,%3,%4,%5,%6,%7,%8,%9")
+                                 .arg(index.size())
+                                 .arg(addNs / 1e6, 0, 'f', 1)
+                                 .arg(index.memoryUsage() / 1048576.0, 0, 'f', 1)
+                                 .arg(length)
+                                 .arg(queries)
+                                 .arg(double(totalHits) / queries, 0, 'f', 1)
+                                 .arg(PipelineTrace::percentileMs(elapsed, 0.50) * 1e3, 0, 'f', 1)
+                                 .arg(PipelineTrace::percentileMs(elapsed, 0.99) * 1e3, 0, 'f', 1)
+                                 .arg(PipelineTrace::percentileMs(elapsed, 1.00) * 1e3, 0, 'f', 1);
+        qInfo().noquote() << line;
+        reportLines.append(line);
+    }
+
+    QFile file("index_report.csv");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to create index_report.csv";
+        return 1;
+    }
+    file.write(reportLines.join('\n').toUtf8());
+    file.write("\n");
+    file.close();
+    qInfo() << "Index report saved to index_report.csv";
+    return 0;
+}
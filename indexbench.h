@@ -0,0 +1,11 @@
+#ifndef INDEXBENCH_H
+#define INDEXBENCH_H
+
+#include <QStringList>
+
+// 全文索引基准：生成合成转写文本建立索引，测量不同长度查询的检索耗时
+// 参数：--segments=<片段数>（默认 500000）、--queries=<每组查询数>（默认 1000）
+// 结果输出到日志并写入 index_report.csv
+int runIndexBench(const QStringList &arguments);
+
+#endif // INDEXBENCH_H
@@ -0,0 +1,362 @@
+#include "latencyharness.h"
+#include "mainwindow.h"
+#include "pipelinetrace.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QThread>
+
+#include <cmath>
+
+namespace {
+
+// 高于该幅度视为语音，用于确定每段语料真实的起止位置
+const float kSpeechAmplitude = 0.02f;
+
+// 回放结束后的静音，保证最后一段语音能被 VAD 判定结束
+const float kTailSeconds = 2.0f;
+
+template <typename T>
+QVector<T> parseList(const QString &value, T (*convert)(const QString &))
+{
+    QVector<T> result;
+    for (const QString &item : value.split(',')) {
+        if (!item.trimmed().isEmpty()) {
+            result.append(convert(item.trimmed()));
+        }
+    }
+    return result;
+}
+
+float toFloat(const QString &s) { return s.toFloat(); }
+int32_t toInt(const QString &s) { return s.toInt(); }
+DecodeScheduler::Policy toPolicy(const QString &s)
+{
+    return s.compare("fifo", Qt::CaseInsensitive) == 0 ? DecodeScheduler::Fifo
+                                                       : DecodeScheduler::Deadline;
+}
+
+const char *policyName(DecodeScheduler::Policy policy)
+{
+    return policy == DecodeScheduler::Fifo ? "fifo" : "deadline";
+}
+
+} // namespace
+
+LatencyHarness::LatencyHarness(MainWindow *window, QObject *parent)
+    : QObject(parent)
+    , m_window(window)
+{
+    connect(m_window, &MainWindow::voiceDataRendered,
+            this, &LatencyHarness::onVoiceDataRendered);
+}
+
+LatencyHarness::~LatencyHarness()
+{
+    stopLoad();
+    stopBackgroundSessions();
+}
+
+bool LatencyHarness::loadCorpus(const QStringList &wavFiles, float gapSeconds)
+{
+    const qint64 gapSamples = static_cast<qint64>(gapSeconds * 16000);
+    m_corpus.assign(gapSamples, 0.0f);
+    m_utterances.clear();
+
+    for (const QString &fileName : wavFiles) {
+        const QByteArray path = fileName.toUtf8();
+        const SherpaOnnxWave *wave = SherpaOnnxReadWave(path.constData());
+        if (wave == NULL) {
+            fprintf(stderr, "Failed to read %s\n", path.constData());
+            continue;
+        }
+        if (wave->sample_rate != 16000) {
+            fprintf(stderr, "Skip %s: expect the sample rate to be 16000. Given: %d\n",
+                    path.constData(), wave->sample_rate);
+            SherpaOnnxFreeWave(wave);
+            continue;
+        }
+
+        int32_t first = 0;
+        int32_t last = wave->num_samples - 1;
+        while (first < last && std::fabs(wave->samples[first]) < kSpeechAmplitude) ++first;
+        while (last > first && std::fabs(wave->samples[last]) < kSpeechAmplitude) --last;
+
+        const qint64 offset = static_cast<qint64>(m_corpus.size());
+        m_corpus.insert(m_corpus.end(), wave->samples, wave->samples + wave->num_samples);
+        m_corpus.insert(m_corpus.end(), gapSamples, 0.0f);
+        m_utterances.append(Utterance{offset + first, offset + last + 1});
+
+        SherpaOnnxFreeWave(wave);
+    }
+
+    m_corpus.insert(m_corpus.end(), static_cast<size_t>(kTailSeconds * 16000), 0.0f);
+    return !m_utterances.isEmpty();
+}
+
+void LatencyHarness::parseArguments(const QStringList &arguments)
+{
+    for (const QString &argument : arguments) {
+        const QString value = argument.section('=', 1);
+        if (argument.startsWith("--silence=")) {
+            m_silenceDurations = parseList<float>(value, toFloat);
+        } else if (argument.startsWith("--window=")) {
+            m_windowSizes = parseList<int32_t>(value, toInt);
+        } else if (argument.startsWith("--threads=")) {
+            m_threadCounts = parseList<int32_t>(value, toInt);
+        } else if (argument.startsWith("--load=")) {
+            m_loadLevels = parseList<int>(value, toInt);
+        } else if (argument.startsWith("--policy=")) {
+            m_policies = parseList<DecodeScheduler::Policy>(value, toPolicy);
+        } else if (argument.startsWith("--sessions=")) {
+            m_backgroundSessions = parseList<int>(value, toInt);
+        }
+    }
+}
+
+void LatencyHarness::start()
+{
+    // 固定识别器配置，各轮结果才可比较
+    m_profile = RecognizerCalibration::profile();
+    qInfo().noquote() << "Latency bench recognizer:" << m_profile.model << m_profile.provider
+                      << m_profile.numThreads << "threads";
+
+    m_runs.clear();
+    for (int sessions : std::as_const(m_backgroundSessions)) {
+        for (DecodeScheduler::Policy policy : std::as_const(m_policies)) {
+            for (int load : std::as_const(m_loadLevels)) {
+                for (int32_t threads : std::as_const(m_threadCounts)) {
+                    for (int32_t window : std::as_const(m_windowSizes)) {
+                        for (float silence : std::as_const(m_silenceDurations)) {
+                            RunConfig run;
+                            run.settings.minSilenceDuration = silence;
+                            run.settings.windowSize = window;
+                            run.settings.numThreads = threads;
+                            run.settings.profile = m_profile;
+                            run.loadThreads = load;
+                            run.policy = policy;
+                            run.backgroundSessions = sessions;
+                            m_runs.append(run);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    m_reportLines.clear();
+    m_reportLines.append("min_silence,window_size,threads,load,policy,sessions,utterances,missed,"
+                         "send_p50_ms,send_p90_ms,send_p99_ms,send_max_ms,"
+                         "render_p50_ms,render_p90_ms,render_p99_ms,render_max_ms,"
+                         "queue_p50_ms,queue_p99_ms,queue_max_ms,long_queue_p99_ms,deadline_misses,"
+                         "background_queue_p99_ms,promoted,model,provider");
+    m_runIndex = -1;
+    runNext();
+}
+
+void LatencyHarness::runNext()
+{
+    ++m_runIndex;
+    if (m_runIndex >= m_runs.size()) {
+        writeReport();
+        emit finished();
+        return;
+    }
+
+    const RunConfig &run = m_runs[m_runIndex];
+    qInfo() << "Latency run" << m_runIndex + 1 << "/" << m_runs.size()
+            << "min_silence" << run.settings.minSilenceDuration
+            << "window" << run.settings.windowSize
+            << "threads" << run.settings.numThreads
+            << "load" << run.loadThreads
+            << "policy" << policyName(run.policy)
+            << "sessions" << run.backgroundSessions;
+
+    // 先连接本对象的槽，保证界面显示之前发送时刻已经记下
+    m_capture = new AudioCapture(run.settings, this);
+    connect(m_capture, &AudioCapture::voiceDataSend,
+            this, &LatencyHarness::onVoiceDataSend);
+    connect(m_capture, &AudioCapture::voiceDataUpdated,
+            this, &LatencyHarness::onVoiceDataUpdated);
+    m_window->attachAudioCapture(m_capture);
+    connect(m_capture, &AudioCapture::replayFinished,
+            this, &LatencyHarness::onReplayFinished);
+
+    // 后台会话以相同设置同时回放语料，不显示、不做说话人分离和标点，只制造解码积压
+    for (int i = 0; i < run.backgroundSessions; ++i) {
+        CaptureSettings settings = run.settings;
+        settings.interactive = false;
+        settings.diarization = false;
+        settings.punctuation = false;
+        m_background.append(new AudioCapture(settings, this));
+    }
+
+    m_emissions.clear();
+    DecodeScheduler::instance().setPolicy(run.policy);
+    DecodeScheduler::instance().resetStats();
+    startLoad(run.loadThreads);
+
+    m_runStartNs = PipelineTrace::nowNs();
+    m_capture->startReplay(m_corpus);
+    for (AudioCapture *capture : std::as_const(m_background)) {
+        capture->startReplay(m_corpus);
+    }
+}
+
+void LatencyHarness::onVoiceDataSend(const VoiceData &data)
+{
+    m_emissions.append(Emission{data.id, data.time, PipelineTrace::nowNs(), -1});
+}
+
+void LatencyHarness::onVoiceDataUpdated(const VoiceData &data)
+{
+    // 只有结束时间变长才是新的一部分文本到达，标点和说话人更新不计
+    for (int i = m_emissions.size() - 1; i >= 0; --i) {
+        if (m_emissions[i].id != data.id) continue;
+        if (data.time.second > m_emissions[i].time.second) {
+            m_emissions.append(Emission{data.id, data.time, PipelineTrace::nowNs(), -1});
+        }
+        return;
+    }
+}
+
+void LatencyHarness::onVoiceDataRendered(const VoiceData &data)
+{
+    // 按序号和结束时间找到对应的发送记录，只记第一次显示
+    for (int i = m_emissions.size() - 1; i >= 0; --i) {
+        Emission &emission = m_emissions[i];
+        if (emission.id == data.id && emission.time.second == data.time.second) {
+            if (emission.renderNs < 0) {
+                emission.renderNs = PipelineTrace::nowNs();
+            }
+            return;
+        }
+    }
+}
+
+void LatencyHarness::onReplayFinished()
+{
+    stopLoad();
+    stopBackgroundSessions();
+    finishRun();
+
+    // 当前仍在 m_capture 的信号里，延迟销毁
+    m_capture->deleteLater();
+    m_capture = nullptr;
+    QTimer::singleShot(0, this, &LatencyHarness::runNext);
+}
+
+void LatencyHarness::finishRun()
+{
+    std::vector<qint64> sendLatency;
+    std::vector<qint64> renderLatency;
+    int missed = 0;
+
+    for (const Utterance &utterance : std::as_const(m_utterances)) {
+        const float begin = utterance.startSample / 16000.0f;
+        const float end = utterance.endSample / 16000.0f;
+
+        // 取与该段语音重叠的最后一次输出，即整句文本全部到达的时间
+        qint64 sendNs = -1;
+        qint64 renderNs = -1;
+        for (const Emission &emission : std::as_const(m_emissions)) {
+            if (emission.time.second < begin || emission.time.first > end) continue;
+            sendNs = qMax(sendNs, emission.emitNs);
+            renderNs = qMax(renderNs, emission.renderNs);
+        }
+
+        if (sendNs < 0) {
+            ++missed;
+            continue;
+        }
+
+        const qint64 endNs = m_runStartNs + utterance.endSample * 1000000000LL / 16000;
+        sendLatency.push_back(sendNs - endNs);
+        if (renderNs >= 0) {
+            renderLatency.push_back(renderNs - endNs);
+        }
+    }
+
+    // 调度统计在每轮开始时清零；被测会话的片段为两个交互类，后台会话的片段为短片段类或长片段类
+    const DecodeScheduler &scheduler = DecodeScheduler::instance();
+    const DecodeScheduler::QueueStats queue = scheduler.stats(DecodeScheduler::Interactive);
+    const DecodeScheduler::QueueStats longStats = scheduler.stats(DecodeScheduler::InteractiveLong);
+    const DecodeScheduler::QueueStats shortStats = scheduler.stats(DecodeScheduler::Short);
+    const DecodeScheduler::QueueStats bulkStats = scheduler.stats(DecodeScheduler::Bulk);
+
+    const RunConfig &run = m_runs[m_runIndex];
+    const QString line = QString("%1,%2,%3,%4,%5,%6,%7,%8,%9,%10,%11,%12,%13,%14,"
+                                 "%15,%16,%17,%18,%19,%20,%21,%22,%23,%24,%25")
+                             .arg(run.settings.minSilenceDuration)
+                             .arg(run.settings.windowSize)
+                             .arg(run.settings.numThreads)
+                             .arg(run.loadThreads)
+                             .arg(policyName(run.policy))
+                             .arg(run.backgroundSessions)
+                             .arg(m_utterances.size())
+                             .arg(missed)
+                             .arg(PipelineTrace::percentileMs(sendLatency, 0.50), 0, 'f', 1)
+                             .arg(PipelineTrace::percentileMs(sendLatency, 0.90), 0, 'f', 1)
+                             .arg(PipelineTrace::percentileMs(sendLatency, 0.99), 0, 'f', 1)
+                             .arg(PipelineTrace::percentileMs(sendLatency, 1.00), 0, 'f', 1)
+                             .arg(PipelineTrace::percentileMs(renderLatency, 0.50), 0, 'f', 1)
+                             .arg(PipelineTrace::percentileMs(renderLatency, 0.90), 0, 'f', 1)
+                             .arg(PipelineTrace::percentileMs(renderLatency, 0.99), 0, 'f', 1)
+                             .arg(PipelineTrace::percentileMs(renderLatency, 1.00), 0, 'f', 1)
+                             .arg(queue.queueP50Ms, 0, 'f', 1)
+                             .arg(queue.queueP99Ms, 0, 'f', 1)
+                             .arg(queue.queueMaxMs, 0, 'f', 1)
+                             .arg(longStats.queueP99Ms, 0, 'f', 1)
+                             .arg(queue.deadlineMisses + longStats.deadlineMisses)
+                             .arg(qMax(shortStats.queueP99Ms, bulkStats.queueP99Ms), 0, 'f', 1)
+                             .arg(longStats.promoted + shortStats.promoted + bulkStats.promoted)
+                             .arg(m_profile.model)
+                             .arg(m_profile.provider);
+    qInfo().noquote() << line;
+    m_reportLines.append(line);
+}
+
+void LatencyHarness::startLoad(int threads)
+{
+    // 模拟其它进程占用 CPU 的负载
+    m_loadStop = false;
+    for (int i = 0; i < threads; ++i) {
+        m_loadThreads.emplace_back([this]() {
+            volatile double sink = 0.0;
+            while (!m_loadStop.load(std::memory_order_relaxed)) {
+                for (int k = 0; k < 10000; ++k) {
+                    sink = sink + std::sqrt(static_cast<double>(k));
+                }
+            }
+        });
+    }
+}
+
+void LatencyHarness::stopLoad()
+{
+    m_loadStop = true;
+    for (std::thread &thread : m_loadThreads) {
+        thread.join();
+    }
+    m_loadThreads.clear();
+}
+
+void LatencyHarness::stopBackgroundSessions()
+{
+    // 析构时会从解码调度中移除会话，丢弃其积压的片段
+    qDeleteAll(m_background);
+    m_background.clear();
+}
+
+void LatencyHarness::writeReport()
+{
+    QFile file("latency_report.csv");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to create latency_report.csv";
+        return;
+    }
+    file.write(m_reportLines.join('\n').toUtf8());
+    file.write("\n");
+    file.close();
+    qInfo() << "Latency report saved to latency_report.csv";
+}
@@ -0,0 +1,100 @@
+#ifndef LATENCYHARNESS_H
+#define LATENCYHARNESS_H
+
+#include "audiocapture.h"
+#include "decodescheduler.h"
+
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+class MainWindow;
+
+// 端到端延迟测试：把已知语音按实时速度回放进采集流水线，
+// 统计从语音结束到 voiceDataSend 发出、以及到界面显示之间的延迟分布
+class LatencyHarness : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LatencyHarness(MainWindow *window, QObject *parent = nullptr);
+    ~LatencyHarness();
+
+    // 读取语料并拼接，每段之间插入 gapSeconds 秒静音；只接受 16kHz 音频
+    bool loadCorpus(const QStringList &wavFiles, float gapSeconds);
+
+    // 解析 --silence= --window= --threads= --load= --policy= --sessions= 参数，未给出的保持默认值
+    // --sessions 为同时回放同一语料的后台（非交互）会话数，与 --policy=fifo,deadline 一起对比过载时的尾延迟
+    void parseArguments(const QStringList &arguments);
+
+    void start();
+
+public:signals:
+    void finished();
+
+private slots:
+    void onVoiceDataSend(const VoiceData &data);
+    void onVoiceDataUpdated(const VoiceData &data);
+    void onVoiceDataRendered(const VoiceData &data);
+    void onReplayFinished();
+
+private:
+    struct Utterance
+    {
+        qint64 startSample;
+        qint64 endSample;  // 最后一个非静音采样的位置
+    };
+
+    // 一句话的文本每到达一部分记一次，按 VoiceData::id 与界面显示对应
+    struct Emission
+    {
+        qint64 id;
+        std::pair<float, float> time;
+        qint64 emitNs;
+        qint64 renderNs;
+    };
+
+    struct RunConfig
+    {
+        CaptureSettings settings;
+        int loadThreads;
+        DecodeScheduler::Policy policy;
+        int backgroundSessions;
+    };
+
+    void runNext();
+    void finishRun();
+    void startLoad(int threads);
+    void stopLoad();
+    void stopBackgroundSessions();
+    void writeReport();
+
+    MainWindow *m_window;
+    AudioCapture *m_capture = nullptr;
+    QVector<AudioCapture *> m_background;
+
+    std::vector<float> m_corpus;
+    QVector<Utterance> m_utterances;
+
+    QVector<float> m_silenceDurations{0.1f, 0.2f, 0.5f};
+    QVector<int32_t> m_windowSizes{512};
+    QVector<int32_t> m_threadCounts{1, 2, 4};
+    QVector<int> m_loadLevels{0, 2};
+    QVector<DecodeScheduler::Policy> m_policies{DecodeScheduler::Deadline};
+    QVector<int> m_backgroundSessions{0};
+
+    RecognizerProfile m_profile;  // 开始时固定的识别器配置，所有轮次和后台会话都使用它
+    QVector<RunConfig> m_runs;
+    int m_runIndex = -1;
+    qint64 m_runStartNs = 0;
+    QVector<Emission> m_emissions;
+    QStringList m_reportLines;
+
+    std::atomic<bool> m_loadStop{false};
+    std::vector<std::thread> m_loadThreads;
+};
+
+#endif // LATENCYHARNESS_H
@@ -1,4 +1,8 @@
 #include "mainwindow.h"
+#include "pipelinetrace.h"
+#include "latencyharness.h"
+#include "recognizerprofile.h"
+#include "indexbench.h"
 
 #include <QApplication>
 #include <QLocale>
@@ -17,7 +21,67 @@ int main(int argc, char *argv[])
             break;
         }
     }
-    MainWindow w;
-    w.show();
-    return a.exec();
+
+    // --index-bench：全文索引检索耗时基准，不打开窗口
+    if (a.arguments().contains("--index-bench")) {
+        return runIndexBench(a.arguments());
+    }
+
+    // 设置环境变量 VOICETEST_TRACE=<文件路径> 开启流水线追踪，退出时写出 Chrome trace JSON
+    const QString tracePath = qEnvironmentVariable("VOICETEST_TRACE");
+    if (!tracePath.isEmpty()) {
+        PipelineTrace::enable();
+    }
+
+    // --calibrate：重新测试本机最快的识别器配置；没有缓存时窗口打开后在后台自动校准，
+    // --latency-bench 和 --file 运行时不自动校准，整个运行使用同一份配置
+    if (a.arguments().contains("--calibrate")) {
+        RecognizerCalibration::calibrate();
+    }
+
+    int ret = 0;
+    {
+        MainWindow w;
+        w.show();
+
+        // --latency-bench：回放自带语料，测量端到端延迟后退出
+        LatencyHarness *harness = nullptr;
+        if (a.arguments().contains("--latency-bench")) {
+            harness = new LatencyHarness(&w, &w);
+            harness->parseArguments(a.arguments());
+            const QString dir = "sherpa-onnx-paraformer-zh-small/";
+            const QStringList corpus = {dir + "0.wav", dir + "1.wav", dir + "2-zh-en.wav",
+                                        dir + "3-sichuan.wav", dir + "4-tianjin.wav",
+                                        dir + "5-henan.wav"};
+            if (!harness->loadCorpus(corpus, 1.5f)) {
+                fprintf(stderr, "No usable latency corpus found\n");
+                return 1;
+            }
+            QObject::connect(harness, &LatencyHarness::finished, &a, &QApplication::quit);
+            harness->start();
+        }
+
+        // --file=<路径> [--offset=<秒>]：流式解码音频文件
+        QString filePath;
+        double fileOffset = 0.0;
+        for (const QString &argument : a.arguments()) {
+            if (argument.startsWith("--file=")) filePath = argument.section('=', 1);
+            if (argument.startsWith("--offset=")) fileOffset = argument.section('=', 1).toDouble();
+        }
+        if (!filePath.isEmpty() && !w.openAudioFile(filePath, fileOffset)) {
+            fprintf(stderr, "Failed to open %s\n", filePath.toUtf8().constData());
+        }
+
+        if (!harness && filePath.isEmpty()) {
+            w.startBackgroundCalibration();
+        }
+
+        ret = a.exec();
+    }
+
+    // 窗口析构时会处理剩余音频，之后再写出追踪文件
+    if (PipelineTrace::isEnabled()) {
+        PipelineTrace::writeChromeTrace(tracePath);
+    }
+    return ret;
 }
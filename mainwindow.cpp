@@ -1,5 +1,7 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
+#include "recognizerprofile.h"
+#include "audiofilereader.h"
 
 
 #include <stdio.h>
@@ -11,6 +13,9 @@
 #include <QDebug>
 #include <QDir>
 #include <QMessageBox>
+#include <QElapsedTimer>
+
+#include <algorithm>
 
 
 MainWindow::MainWindow(QWidget *parent)
@@ -23,40 +28,15 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->testBtn, &QPushButton::clicked, this, [this, appDir]() {
         const char *wav_filename =
             "sherpa-onnx-paraformer-zh-small/0.wav";
-        const char *model_filename =
-            "sherpa-onnx-paraformer-zh-small/model.int8.onnx";
-        const char *tokens_filename =
-            "sherpa-onnx-paraformer-zh-small/tokens.txt";
-        const char *provider = "cpu";
-
         const SherpaOnnxWave *wave = SherpaOnnxReadWave(wav_filename);
         if (wave == NULL) {
             fprintf(stderr, "Failed to read %s\n", wav_filename);
             return ;
         }
 
-        // Paraformer config
-        SherpaOnnxOfflineParaformerModelConfig paraformer_config;
-        memset(&paraformer_config, 0, sizeof(paraformer_config));
-        paraformer_config.model = model_filename;
-
-        // Offline model config
-        SherpaOnnxOfflineModelConfig offline_model_config;
-        memset(&offline_model_config, 0, sizeof(offline_model_config));
-        offline_model_config.debug = 1;
-        offline_model_config.num_threads = 1;
-        offline_model_config.provider = provider;
-        offline_model_config.tokens = tokens_filename;
-        offline_model_config.paraformer = paraformer_config;
-
-        // Recognizer config
-        SherpaOnnxOfflineRecognizerConfig recognizer_config;
-        memset(&recognizer_config, 0, sizeof(recognizer_config));
-        recognizer_config.decoding_method = "greedy_search";
-        recognizer_config.model_config = offline_model_config;
-
+        // 与实时识别使用同一份校准配置
         const SherpaOnnxOfflineRecognizer *recognizer =
-            SherpaOnnxCreateOfflineRecognizer(&recognizer_config);
+            RecognizerCalibration::createRecognizer(RecognizerCalibration::profile());
 
         /////////////////
         if (recognizer == NULL) {
@@ -88,15 +68,10 @@ MainWindow::MainWindow(QWidget *parent)
         if (!SherpaOnnxFileExists(wav_filename)) {
             fprintf(stderr, "Please download %s\n", wav_filename);
         }
-        const SherpaOnnxWave *wave = SherpaOnnxReadWave(wav_filename);
-        if (wave == NULL) {
-            fprintf(stderr, "Failed to read %s\n", wav_filename);
-            return;
-        }
-        if (wave->sample_rate != 16000) {
-            fprintf(stderr, "Expect the sample rate to be 16000. Given: %d\n",
-                    wave->sample_rate);
-            SherpaOnnxFreeWave(wave);
+        // 流式读取，任意采样率/声道数都会转换为 16kHz 单声道
+        AudioFileReader reader;
+        if (!reader.open(wav_filename)) {
+            fprintf(stderr, "%s\n", reader.errorString().toUtf8().constData());
             return;
         }
 
@@ -148,21 +123,23 @@ MainWindow::MainWindow(QWidget *parent)
 
         if (vad == NULL) {
             fprintf(stderr, "Please check your recognizer config!\n");
-            SherpaOnnxFreeWave(wave);
             return ;
         }
 
         int32_t window_size = use_silero_vad ? vadConfig.silero_vad.window_size
                                              : vadConfig.ten_vad.window_size;
 
-        int32_t i = 0;
+        std::vector<float> samples;
         int is_eof = 0;
 
         while (!is_eof) {
-            if (i + window_size < wave->num_samples) {
-                SherpaOnnxVoiceActivityDetectorAcceptWaveform(vad, wave->samples + i,
-                                                              window_size);
-            } else {
+            samples.clear();
+            reader.read(samples, window_size);
+            if (!samples.empty()) {
+                SherpaOnnxVoiceActivityDetectorAcceptWaveform(vad, samples.data(),
+                                                              static_cast<int32_t>(samples.size()));
+            }
+            if (reader.atEnd()) {
                 SherpaOnnxVoiceActivityDetectorFlush(vad);
                 is_eof = 1;
             }
@@ -181,18 +158,14 @@ MainWindow::MainWindow(QWidget *parent)
                 SherpaOnnxDestroySpeechSegment(segment);
                 SherpaOnnxVoiceActivityDetectorPop(vad);
             }
-            i += window_size;
         }
 
-
-        SherpaOnnxFreeWave(wave);
+        SherpaOnnxDestroyVoiceActivityDetector(vad);
     });
 
 
     audioCapture = new AudioCapture(this);
-
-    connect(audioCapture, &AudioCapture::voiceDataSend,
-            this, &MainWindow::onVoiceDataReceived);
+    attachAudioCapture(audioCapture);
 
     connect(ui->testBtn2, &QPushButton::clicked, this, [this, appDir]() {
         audioCapture->startCapture();
@@ -201,24 +174,130 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->testBtn3, &QPushButton::clicked, this, [this, appDir]() {
         audioCapture->stopCapture();  // 停止录音
     });
+
+    connect(ui->searchEdit, &QLineEdit::textChanged,
+            this, &MainWindow::onSearchTextChanged);
 }
 
 MainWindow::~MainWindow()
 {
+    // 回调引用了本窗口，先停止后台校准
+    RecognizerCalibration::cancelBackgroundCalibration();
     delete ui;
 }
 
-void MainWindow::onVoiceDataReceived(const VoiceData& data)
+void MainWindow::startBackgroundCalibration()
 {
-    // 格式化显示文本，例如："[开始时间-结束时间] 识别文本"
-    QString displayText = QString("[%1-%2] %3")
+    // 首次运行没有校准缓存：先用默认配置，后台校准，完成后新建的识别会话使用校准结果
+    if (!RecognizerCalibration::isCalibrated()) {
+        ui->statusbar->showMessage("首次运行，空闲时在后台校准识别器...");
+        RecognizerCalibration::calibrateInBackground(
+            [this](int done, int total) {
+                QMetaObject::invokeMethod(this, [this, done, total]() {
+                    ui->statusbar->showMessage(QString("正在后台校准识别器 %1/%2").arg(done).arg(total));
+                }, Qt::QueuedConnection);
+            },
+            [this](const RecognizerProfile &profile) {
+                QMetaObject::invokeMethod(this, [this, profile]() {
+                    ui->statusbar->showMessage(QString("识别器校准完成：%1 线程，RTF %2")
+                                                   .arg(profile.numThreads)
+                                                   .arg(profile.rtf, 0, 'f', 3), 5000);
+                }, Qt::QueuedConnection);
+            });
+    }
+}
+
+bool MainWindow::openAudioFile(const QString &path, double offsetSeconds)
+{
+    return audioCapture->startFile(path, offsetSeconds);
+}
+
+void MainWindow::attachAudioCapture(AudioCapture *capture)
+{
+    connect(capture, &AudioCapture::voiceDataSend,
+            this, &MainWindow::onVoiceDataReceived);
+    connect(capture, &AudioCapture::voiceDataUpdated,
+            this, &MainWindow::onVoiceDataUpdated);
+}
+
+QString MainWindow::formatVoiceData(const VoiceData& data) const
+{
+    // 格式化显示文本，例如："[开始时间-结束时间] 说话人1: 识别文本"
+    QString displayText = QString("[%1-%2] ")
                               .arg(data.time.first, 0, 'f', 2)
-                              .arg(data.time.second, 0, 'f', 2)
-                              .arg(data.context);
+                              .arg(data.time.second, 0, 'f', 2);
+    if (!data.speaker.isEmpty()) {
+        displayText += data.speaker + ": ";
+    }
+    return displayText + data.context;
+}
 
-    // 添加到listWidget
-    ui->listWidget->addItem(displayText);
+void MainWindow::onVoiceDataReceived(const VoiceData& data)
+{
+    // 添加到listWidget，记下序号以便之后更新这一行
+    QListWidgetItem *item = new QListWidgetItem(formatVoiceData(data));
+    item->setData(Qt::UserRole, data.id);
+
+    // 调度可能让后面的短句先于前面的长句解码完成，按序号插入，保持时间顺序
+    int row = ui->listWidget->count();
+    while (row > 0 && ui->listWidget->item(row - 1)->data(Qt::UserRole).toLongLong() > data.id) {
+        --row;
+    }
+    const bool atBottom = row == ui->listWidget->count();
+    ui->listWidget->insertItem(row, item);
+
+    // 加入全文索引，记下索引序号，补标点和说话人后同步更新
+    item->setData(Qt::UserRole + 1, transcriptIndex.add(data));
 
     // 可选：自动滚动到最后一项
-    ui->listWidget->scrollToBottom();
+    if (atBottom) {
+        ui->listWidget->scrollToBottom();
+    }
+
+    emit voiceDataRendered(data);
+}
+
+void MainWindow::onVoiceDataUpdated(const VoiceData& data)
+{
+    // 更新通常针对最近的几行，从后往前找
+    for (int row = ui->listWidget->count() - 1; row >= 0; --row) {
+        QListWidgetItem *item = ui->listWidget->item(row);
+        if (item->data(Qt::UserRole).toLongLong() == data.id) {
+            item->setText(formatVoiceData(data));
+            transcriptIndex.update(item->data(Qt::UserRole + 1).toLongLong(), data);
+            emit voiceDataRendered(data);
+            return;
+        }
+    }
+}
+
+void MainWindow::onSearchTextChanged(const QString& text)
+{
+    ui->searchResultList->clear();
+    if (text.isEmpty()) {
+        ui->statusbar->clearMessage();
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QVector<TranscriptHit> hits = transcriptIndex.search(text);
+    const qint64 elapsedUs = timer.nsecsElapsed() / 1000;
+
+    // 索引按到达顺序编号，乱序到达的句子按识别序号排回时间顺序
+    std::stable_sort(hits.begin(), hits.end(), [](const TranscriptHit &a, const TranscriptHit &b) {
+        return a.data.id > b.data.id;
+    });
+
+    for (const TranscriptHit &hit : hits) {
+        ui->searchResultList->addItem(QString("[%1-%2] %3")
+                                          .arg(hit.data.time.first, 0, 'f', 2)
+                                          .arg(hit.data.time.second, 0, 'f', 2)
+                                          .arg(hit.data.context));
+    }
+
+    ui->statusbar->showMessage(QString("%1 条结果（共 %2 段），耗时 %3 us")
+                                   .arg(hits.size())
+                                   .arg(transcriptIndex.size())
+                                   .arg(elapsedUs));
 }
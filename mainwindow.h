@@ -2,6 +2,7 @@
 #define MAINWINDOW_H
 
 #include "audiocapture.h"
+#include "transcriptindex.h"
 #include <QMainWindow>
 
 QT_BEGIN_NAMESPACE
@@ -18,14 +19,31 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    // 把另一个采集实例的输出也显示到列表中
+    void attachAudioCapture(AudioCapture *capture);
+
+    // 流式解码音频文件，结果显示在列表中
+    bool openAudioFile(const QString &path, double offsetSeconds = 0.0);
+
+    // 没有校准缓存时在后台校准识别器，进度显示在状态栏；采集进行时校准暂停
+    void startBackgroundCalibration();
+
+public:signals:
+    // 一条识别结果已添加到列表或已更新列表中的对应行
+    void voiceDataRendered(const VoiceData& data);
+
 private:
     Ui::MainWindow *ui;
 
     AudioCapture *audioCapture;
+    TranscriptIndex transcriptIndex;
 
     size_t ReadFile(const char *filename, char **buffer_out);
+    QString formatVoiceData(const VoiceData& data) const;
 
 private slots:
     void onVoiceDataReceived(const VoiceData& data);
+    void onSearchTextChanged(const QString& text);
+    void onVoiceDataUpdated(const VoiceData& data);
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,158 @@
+#include "pipelinetrace.h"
+
+#include <QFile>
+#include <QThread>
+#include <QDebug>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct TraceEvent
+{
+    const char *name;
+    qint64 startNs;
+    qint64 durationNs;
+    qint64 value;
+};
+
+// 每个线程一个环形缓冲区，只有所属线程写入，写入路径无锁
+struct ThreadBuffer
+{
+    explicit ThreadBuffer(int capacity)
+        : events(static_cast<size_t>(capacity))
+        , threadId(reinterpret_cast<quintptr>(QThread::currentThreadId()))
+    {
+    }
+
+    std::vector<TraceEvent> events;
+    std::atomic<quint64> head{0};
+    std::atomic<quint64> generation{0};  // 缓冲区内事件属于第几次 enable()
+    quintptr threadId;
+};
+
+// 缓冲区注册表，只在线程第一次写事件和导出时加锁
+// 缓冲区在程序结束前不释放，线程退出后其事件仍可导出
+std::mutex g_registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+std::atomic<int> g_capacity{PipelineTrace::kDefaultCapacity};
+// 每次 enable() 加一；缓冲区由所属线程在下次写入时发现代数变化后自行清空
+std::atomic<quint64> g_generation{0};
+
+thread_local ThreadBuffer *t_buffer = nullptr;
+
+const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+ThreadBuffer *threadBuffer()
+{
+    if (!t_buffer) {
+        auto buffer = std::make_unique<ThreadBuffer>(g_capacity.load(std::memory_order_relaxed));
+        buffer->generation.store(g_generation.load(std::memory_order_acquire),
+                                 std::memory_order_relaxed);
+        t_buffer = buffer.get();
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        g_buffers.push_back(std::move(buffer));
+    }
+    return t_buffer;
+}
+
+} // namespace
+
+std::atomic<bool> PipelineTrace::s_enabled{false};
+
+void PipelineTrace::enable(int capacity)
+{
+    g_capacity.store(qMax(capacity, 1), std::memory_order_relaxed);
+    // 丢弃上一次追踪留下的事件：这里只推进代数，不碰其它线程的 head，
+    // 各缓冲区仍然只由所属线程写入
+    g_generation.fetch_add(1, std::memory_order_release);
+    s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void PipelineTrace::disable()
+{
+    s_enabled.store(false, std::memory_order_relaxed);
+}
+
+qint64 PipelineTrace::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - g_epoch).count();
+}
+
+double PipelineTrace::percentileMs(std::vector<qint64> valuesNs, double p)
+{
+    if (valuesNs.empty()) return std::nan("");
+    std::sort(valuesNs.begin(), valuesNs.end());
+    size_t rank = static_cast<size_t>(std::ceil(p * valuesNs.size()));
+    rank = qBound<size_t>(1, rank, valuesNs.size());
+    return valuesNs[rank - 1] / 1e6;
+}
+
+void PipelineTrace::record(const char *name, qint64 startNs, qint64 durationNs, qint64 value)
+{
+    ThreadBuffer *buffer = threadBuffer();
+    const quint64 generation = g_generation.load(std::memory_order_acquire);
+    if (buffer->generation.load(std::memory_order_relaxed) != generation) {
+        buffer->head.store(0, std::memory_order_relaxed);
+        buffer->generation.store(generation, std::memory_order_release);
+    }
+    const quint64 head = buffer->head.load(std::memory_order_relaxed);
+    buffer->events[head % buffer->events.size()] = TraceEvent{name, startNs, durationNs, value};
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+bool PipelineTrace::writeChromeTrace(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to open trace file" << path;
+        return false;
+    }
+
+    file.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    const quint64 generation = g_generation.load(std::memory_order_acquire);
+    char line[256];
+    bool first = true;
+    qint64 eventCount = 0;
+    for (const auto &buffer : g_buffers) {
+        // 本次追踪开始后没有写过事件的线程，缓冲区里还是上一次的旧事件
+        if (buffer->generation.load(std::memory_order_acquire) != generation) continue;
+        const quint64 head = buffer->head.load(std::memory_order_acquire);
+        const quint64 capacity = buffer->events.size();
+        const quint64 count = qMin(head, capacity);
+
+        // 环形缓冲区写满时只保留最新的 capacity 个事件
+        for (quint64 i = head - count; i < head; ++i) {
+            const TraceEvent &event = buffer->events[i % capacity];
+            // Chrome trace 使用微秒时间戳，"X" 为带持续时间的完整事件
+            int n = snprintf(line, sizeof(line),
+                             "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%llu,"
+                             "\"ts\":%.3f,\"dur\":%.3f",
+                             first ? "" : ",\n", event.name,
+                             static_cast<unsigned long long>(buffer->threadId),
+                             event.startNs / 1000.0, event.durationNs / 1000.0);
+            if (event.value >= 0) {
+                n += snprintf(line + n, sizeof(line) - n, ",\"args\":{\"value\":%lld}",
+                              static_cast<long long>(event.value));
+            }
+            snprintf(line + n, sizeof(line) - n, "}");
+            file.write(line);
+            first = false;
+            ++eventCount;
+        }
+    }
+
+    file.write("\n]}\n");
+    file.close();
+
+    qDebug() << "Trace saved to" << path << "(" << eventCount << "events )";
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef PIPELINETRACE_H
+#define PIPELINETRACE_H
+
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// 音频处理流水线的时间线追踪，导出为 Chrome trace-event JSON（可直接用 Perfetto 打开）
+// 默认关闭，关闭时每个追踪点只有一次原子读取的开销
+class PipelineTrace
+{
+public:
+    // 开启追踪；capacity 为每个线程环形缓冲区可保存的事件数，写满后覆盖最旧的事件
+    static void enable(int capacity = kDefaultCapacity);
+    static void disable();
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    // name 必须是生命周期为整个程序的字符串（例如字符串字面量）
+    static void record(const char *name, qint64 startNs, qint64 durationNs, qint64 value);
+    static qint64 nowNs();
+
+    // 一组纳秒耗时的 p 分位数（p 取 0~1，1 为最大值），单位毫秒；没有数据时返回 NaN
+    static double percentileMs(std::vector<qint64> valuesNs, double p);
+
+    // 写出所有线程的事件；建议在停止采集后调用
+    static bool writeChromeTrace(const QString &path);
+
+    static constexpr int kDefaultCapacity = 1 << 16;
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+// 作用域追踪：构造时记录开始时间，析构时写入一个完整事件
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name, qint64 value = -1)
+        : m_name(PipelineTrace::isEnabled() ? name : nullptr)
+        , m_start(m_name ? PipelineTrace::nowNs() : 0)
+        , m_value(value)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (m_name) {
+            PipelineTrace::record(m_name, m_start, PipelineTrace::nowNs() - m_start, m_value);
+        }
+    }
+
+    void setValue(qint64 value) { m_value = value; }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *m_name;
+    qint64 m_start;
+    qint64 m_value;
+};
+
+#endif // PIPELINETRACE_H
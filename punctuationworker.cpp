@@ -0,0 +1,167 @@
+#include "punctuationworker.h"
+
+#include <QDebug>
+
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+bool isAsciiLetter(QChar c)
+{
+    return c.unicode() < 0x80 && c.isLetterOrNumber();
+}
+
+} // namespace
+
+PunctuationWorker::PunctuationWorker(const char *modelFilename, QObject *parent)
+    : QObject(parent)
+{
+    if (!SherpaOnnxFileExists(modelFilename)) {
+        fprintf(stderr, "Punctuation model %s not found, punctuation disabled\n", modelFilename);
+        return;
+    }
+
+    SherpaOnnxOfflinePunctuationConfig config;
+    memset(&config, 0, sizeof(config));
+    config.model.ct_transformer = modelFilename;
+    config.model.num_threads = 1;
+    config.model.debug = 0;
+    config.model.provider = "cpu";
+
+    m_punct = SherpaOnnxCreateOfflinePunctuation(&config);
+    if (m_punct == NULL) {
+        fprintf(stderr, "Please check your punctuation config!\n");
+        return;
+    }
+
+    m_worker = std::thread(&PunctuationWorker::workerLoop, this);
+}
+
+PunctuationWorker::~PunctuationWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_stop = true;
+    }
+    m_queueCondition.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+
+    if (m_punct) {
+        SherpaOnnxDestroyOfflinePunctuation(m_punct);
+    }
+}
+
+void PunctuationWorker::submit(qint64 id, const QString &text)
+{
+    if (!isReady() || text.isEmpty()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_queue.push_back(Job{id, text});
+    }
+    m_queueCondition.notify_one();
+}
+
+void PunctuationWorker::workerLoop()
+{
+    QVector<Job> batch;
+    QVector<QString> results;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_queueCondition.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+            if (m_stop) return;
+
+            // 等一小段时间让相邻片段到齐，合并后上下文更完整，模型调用也更少
+            m_queueCondition.wait_for(lock, std::chrono::milliseconds(kCoalesceMs), [this]() {
+                return m_stop || static_cast<int>(m_queue.size()) >= kMaxBatch;
+            });
+            if (m_stop) return;
+
+            batch.clear();
+            while (!m_queue.empty() && batch.size() < kMaxBatch) {
+                batch.append(std::move(m_queue.front()));
+                m_queue.pop_front();
+            }
+        }
+
+        if (!punctuateBatch(batch, results)) {
+            // 合并结果对不齐时逐段处理
+            results.clear();
+            for (const Job &job : std::as_const(batch)) {
+                results.append(addPunct(job.text));
+            }
+        }
+
+        for (int i = 0; i < batch.size(); ++i) {
+            emit punctuated(batch[i].id, results[i]);
+        }
+
+        m_context = batch.last().text.right(kContextChars);
+    }
+}
+
+QString PunctuationWorker::addPunct(const QString &text) const
+{
+    const QByteArray input = text.toUtf8();
+    const char *output = SherpaOfflinePunctuationAddPunct(m_punct, input.constData());
+    const QString result = QString::fromUtf8(output);
+    SherpaOfflinePunctuationFreeText(output);
+    return result;
+}
+
+bool PunctuationWorker::punctuateBatch(const QVector<Job> &batch, QVector<QString> &results) const
+{
+    // 拼接上文和本批文本，记录每个非空白字符属于哪个片段（-1 为上文）
+    QString combined;
+    QString rawChars;
+    QVector<int> owners;
+    auto append = [&](const QString &text, int owner) {
+        if (!combined.isEmpty() && !text.isEmpty()
+            && isAsciiLetter(combined.back()) && isAsciiLetter(text.front())) {
+            combined.append(' ');
+        }
+        combined.append(text);
+        for (QChar c : text) {
+            if (c.isSpace()) continue;
+            rawChars.append(c);
+            owners.append(owner);
+        }
+    };
+
+    append(m_context, -1);
+    for (int i = 0; i < batch.size(); ++i) {
+        append(batch[i].text, i);
+    }
+
+    const QString output = addPunct(combined);
+
+    // 模型只插入标点（英文可能改变大小写和空格），按原始字符顺序对齐；
+    // 插入的标点归属于它前面那个字符所在的片段
+    results = QVector<QString>(batch.size());
+    int rawPos = 0;
+    int owner = -1;
+    for (QChar c : output) {
+        if (c.isSpace()) {
+            if (owner >= 0 && !results[owner].isEmpty()) results[owner].append(c);
+            continue;
+        }
+        if (rawPos < rawChars.size() && c.toLower() == rawChars[rawPos].toLower()) {
+            owner = owners[rawPos++];
+        } else if (!c.isPunct()) {
+            return false;
+        }
+        if (owner >= 0) results[owner].append(c);
+    }
+
+    if (rawPos != rawChars.size()) return false;
+
+    for (QString &result : results) {
+        result = result.trimmed();
+    }
+    return true;
+}
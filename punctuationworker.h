@@ -0,0 +1,57 @@
+#ifndef PUNCTUATIONWORKER_H
+#define PUNCTUATIONWORKER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <c-api.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// 异步标点：识别文本先原样发送，本工作线程随后补上标点
+// 相邻片段合并成一段文本一起加标点，前一批的末尾作为上文，结果再按片段拆回
+class PunctuationWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PunctuationWorker(const char *modelFilename, QObject *parent = nullptr);
+    ~PunctuationWorker();
+
+    bool isReady() const { return m_punct != NULL; }
+
+    void submit(qint64 id, const QString &text);
+
+public:signals:
+    void punctuated(qint64 id, const QString &text);
+
+private:
+    struct Job
+    {
+        qint64 id;
+        QString text;
+    };
+
+    void workerLoop();
+    QString addPunct(const QString &text) const;
+    // 合并后加标点再拆回各片段；对不齐时返回 false
+    bool punctuateBatch(const QVector<Job> &batch, QVector<QString> &results) const;
+
+    const SherpaOnnxOfflinePunctuation *m_punct = NULL;
+
+    std::thread m_worker;
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCondition;
+    std::deque<Job> m_queue;
+    bool m_stop = false;
+
+    QString m_context;  // 上一批末尾的原始文本，只作为上文，不输出
+
+    static constexpr int kMaxBatch = 8;
+    static constexpr int kCoalesceMs = 200;    // 第一个片段到达后等待相邻片段的时间
+    static constexpr int kContextChars = 32;
+};
+
+#endif // PUNCTUATIONWORKER_H
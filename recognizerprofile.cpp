@@ -0,0 +1,353 @@
+#include "recognizerprofile.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QSettings>
+#include <QSysInfo>
+#include <QThread>
+#include <QElapsedTimer>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define RECOGNIZER_HAS_CPUID 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define RECOGNIZER_HAS_CPUID 1
+#endif
+
+namespace {
+
+const char *kCacheFile = "recognizer_profile.ini";
+const char *kModelDir = "sherpa-onnx-paraformer-zh-small/";
+
+// 当前使用的配置，后台校准完成后更新；已创建的识别器不受影响
+std::mutex g_profileMutex;
+RecognizerProfile g_profile;
+bool g_profileLoaded = false;
+bool g_calibrated = false;
+
+std::mutex g_calibrationMutex;
+std::thread g_calibrationThread;
+std::atomic<bool> g_cancelCalibration{false};
+
+// 正在进行的采集数；每次有采集开始时 g_captureEpoch 加一
+std::mutex g_captureMutex;
+std::condition_variable g_captureCondition;
+int g_activeCaptures = 0;
+quint64 g_captureEpoch = 0;
+
+// 等到没有采集或校准被中止，返回此时的采集计数
+quint64 waitForIdle()
+{
+    std::unique_lock<std::mutex> lock(g_captureMutex);
+    g_captureCondition.wait(lock, []() { return g_activeCaptures == 0 || g_cancelCalibration; });
+    return g_captureEpoch;
+}
+
+bool captureSince(quint64 epoch)
+{
+    std::lock_guard<std::mutex> lock(g_captureMutex);
+    return g_activeCaptures > 0 || g_captureEpoch != epoch;
+}
+
+#ifdef RECOGNIZER_HAS_CPUID
+void cpuid(int leaf, int subleaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, leaf, subleaf);
+    for (int i = 0; i < 4; ++i) regs[i] = static_cast<unsigned int>(info[i]);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+#endif
+
+// 解码自带语料的总耗时（秒），失败返回负数
+double benchmark(const RecognizerProfile &profile, const std::vector<const SherpaOnnxWave *> &waves)
+{
+    const SherpaOnnxOfflineRecognizer *recognizer = RecognizerCalibration::createRecognizer(profile);
+    if (recognizer == NULL) {
+        return -1.0;
+    }
+
+    auto decodeAll = [&]() {
+        for (const SherpaOnnxWave *wave : waves) {
+            const SherpaOnnxOfflineStream *stream = SherpaOnnxCreateOfflineStream(recognizer);
+            SherpaOnnxAcceptWaveformOffline(stream, wave->sample_rate, wave->samples,
+                                            wave->num_samples);
+            SherpaOnnxDecodeOfflineStream(recognizer, stream);
+            SherpaOnnxDestroyOfflineStream(stream);
+        }
+    };
+
+    // 第一次解码包含内存分配和算子初始化，不计入
+    decodeAll();
+
+    QElapsedTimer timer;
+    timer.start();
+    decodeAll();
+    const double seconds = timer.nsecsElapsed() / 1e9;
+
+    SherpaOnnxDestroyOfflineRecognizer(recognizer);
+    return seconds;
+}
+
+} // namespace
+
+QString RecognizerCalibration::cpuKey()
+{
+    QStringList parts;
+    parts << QSysInfo::currentCpuArchitecture();
+
+#ifdef RECOGNIZER_HAS_CPUID
+    unsigned int regs[4] = {0, 0, 0, 0};
+    cpuid(0, 0, regs);
+    const unsigned int maxLeaf = regs[0];
+    if (maxLeaf >= 7) {
+        cpuid(7, 0, regs);
+        if (regs[1] & (1u << 5)) parts << "avx2";
+        if (regs[1] & (1u << 16)) parts << "avx512f";
+        if (regs[2] & (1u << 11)) parts << "avx512vnni";
+        cpuid(7, 1, regs);
+        if (regs[0] & (1u << 4)) parts << "avxvnni";
+    }
+#endif
+
+    parts << QString("t%1").arg(QThread::idealThreadCount());
+    return parts.join('-');
+}
+
+const SherpaOnnxOfflineRecognizer *RecognizerCalibration::createRecognizer(const RecognizerProfile &profile,
+                                                                           int32_t numThreads)
+{
+    // sherpa-onnx 在创建时复制配置字符串，这里的临时 QByteArray 只需活到创建结束
+    const QByteArray model = profile.model.toUtf8();
+    const QByteArray tokens = profile.tokens.toUtf8();
+    const QByteArray provider = profile.provider.toUtf8();
+    const QByteArray decodingMethod = profile.decodingMethod.toUtf8();
+
+    // Paraformer config
+    SherpaOnnxOfflineParaformerModelConfig paraformer_config;
+    memset(&paraformer_config, 0, sizeof(paraformer_config));
+    paraformer_config.model = model.constData();
+
+    // Offline model config
+    SherpaOnnxOfflineModelConfig offline_model_config;
+    memset(&offline_model_config, 0, sizeof(offline_model_config));
+    offline_model_config.debug = 0;
+    offline_model_config.num_threads = numThreads > 0 ? numThreads : profile.numThreads;
+    offline_model_config.provider = provider.constData();
+    offline_model_config.tokens = tokens.constData();
+    offline_model_config.paraformer = paraformer_config;
+
+    // Recognizer config
+    SherpaOnnxOfflineRecognizerConfig recognizer_config;
+    memset(&recognizer_config, 0, sizeof(recognizer_config));
+    recognizer_config.decoding_method = decodingMethod.constData();
+    recognizer_config.model_config = offline_model_config;
+
+    return SherpaOnnxCreateOfflineRecognizer(&recognizer_config);
+}
+
+RecognizerProfile RecognizerCalibration::profile()
+{
+    std::lock_guard<std::mutex> lock(g_profileMutex);
+    if (!g_profileLoaded) {
+        g_calibrated = loadCached(&g_profile);
+        g_profileLoaded = true;
+    }
+    return g_profile;
+}
+
+bool RecognizerCalibration::isCalibrated()
+{
+    profile();
+    std::lock_guard<std::mutex> lock(g_profileMutex);
+    return g_calibrated;
+}
+
+void RecognizerCalibration::calibrateInBackground(const Progress &progress, const Finished &finished)
+{
+    std::lock_guard<std::mutex> lock(g_calibrationMutex);
+    if (g_calibrationThread.joinable()) return;
+
+    g_cancelCalibration = false;
+    g_calibrationThread = std::thread([progress, finished]() {
+        const RecognizerProfile profile = calibrate(progress);
+        if (!g_cancelCalibration && finished) {
+            finished(profile);
+        }
+    });
+}
+
+void RecognizerCalibration::cancelBackgroundCalibration()
+{
+    std::lock_guard<std::mutex> lock(g_calibrationMutex);
+    {
+        // 在 g_captureMutex 下设置，等待空闲的校准线程不会错过唤醒
+        std::lock_guard<std::mutex> captureLock(g_captureMutex);
+        g_cancelCalibration = true;
+    }
+    g_captureCondition.notify_all();
+    if (g_calibrationThread.joinable()) {
+        g_calibrationThread.join();
+    }
+}
+
+void RecognizerCalibration::captureStarted()
+{
+    std::lock_guard<std::mutex> lock(g_captureMutex);
+    ++g_activeCaptures;
+    ++g_captureEpoch;
+}
+
+void RecognizerCalibration::captureStopped()
+{
+    {
+        std::lock_guard<std::mutex> lock(g_captureMutex);
+        g_activeCaptures = qMax(0, g_activeCaptures - 1);
+    }
+    g_captureCondition.notify_all();
+}
+
+bool RecognizerCalibration::loadCached(RecognizerProfile *profile)
+{
+    QSettings settings(kCacheFile, QSettings::IniFormat);
+    settings.beginGroup(cpuKey());
+    const bool found = settings.contains("model") && QFile::exists(settings.value("model").toString());
+    if (found) {
+        profile->model = settings.value("model").toString();
+        profile->provider = settings.value("provider", profile->provider).toString();
+        profile->numThreads = settings.value("num_threads", profile->numThreads).toInt();
+        profile->decodingMethod = settings.value("decoding_method", profile->decodingMethod).toString();
+        profile->rtf = settings.value("rtf", 0.0).toDouble();
+    }
+    settings.endGroup();
+    return found;
+}
+
+void RecognizerCalibration::store(const RecognizerProfile &profile)
+{
+    QSettings settings(kCacheFile, QSettings::IniFormat);
+    settings.beginGroup(cpuKey());
+    settings.setValue("model", profile.model);
+    settings.setValue("provider", profile.provider);
+    settings.setValue("num_threads", profile.numThreads);
+    settings.setValue("decoding_method", profile.decodingMethod);
+    settings.setValue("rtf", profile.rtf);
+    settings.endGroup();
+    settings.sync();
+}
+
+RecognizerProfile RecognizerCalibration::calibrate(const Progress &progress)
+{
+    RecognizerProfile best;
+    const QString dir = kModelDir;
+
+    // 校准语料：自带的 16kHz 示例音频
+    std::vector<const SherpaOnnxWave *> waves;
+    double audioSeconds = 0.0;
+    for (const QString &name : {QString("0.wav"), QString("1.wav"), QString("2-zh-en.wav")}) {
+        const QByteArray path = (dir + name).toUtf8();
+        const SherpaOnnxWave *wave = SherpaOnnxReadWave(path.constData());
+        if (wave == NULL) {
+            fprintf(stderr, "Failed to read %s\n", path.constData());
+            continue;
+        }
+        audioSeconds += static_cast<double>(wave->num_samples) / wave->sample_rate;
+        waves.push_back(wave);
+    }
+    if (waves.empty()) {
+        fprintf(stderr, "No calibration corpus found, use default recognizer profile\n");
+        return best;
+    }
+
+    QStringList models;
+    for (const QString &name : {QString("model.int8.onnx"), QString("model.onnx")}) {
+        if (QFile::exists(dir + name)) models << dir + name;
+    }
+
+    // 只有对应的运行库存在时才测试 GPU 后端，否则 sherpa-onnx 会回退到 CPU，结果没有意义
+    QStringList providers = {"cpu"};
+    if (QFile::exists("onnxruntime_providers_cuda.dll")) providers << "cuda";
+    if (QFile::exists("DirectML.dll")) providers << "directml";
+
+    QList<int32_t> threadCounts;
+    const int32_t maxThreads = qMax(1, QThread::idealThreadCount());
+    for (int32_t threads : {1, 2, 4, 8, maxThreads}) {
+        if (threads <= maxThreads && !threadCounts.contains(threads)) threadCounts << threads;
+    }
+
+    const int total = models.size() * providers.size() * threadCounts.size();
+    int done = 0;
+    double bestSeconds = -1.0;
+    for (const QString &model : std::as_const(models)) {
+        for (const QString &provider : std::as_const(providers)) {
+            for (int32_t threads : std::as_const(threadCounts)) {
+                // 每种配置要完整解码两遍语料，只在配置之间检查中止
+                if (g_cancelCalibration) break;
+
+                RecognizerProfile candidate;
+                candidate.model = model;
+                candidate.provider = provider;
+                candidate.numThreads = threads;
+
+                // 采集进行中测得的 RTF 包含了解码线程的负载，不可用：等空闲后再测，
+                // 测量期间有采集开始则重测
+                double seconds = -1.0;
+                while (true) {
+                    const quint64 epoch = waitForIdle();
+                    if (g_cancelCalibration) break;
+                    seconds = benchmark(candidate, waves);
+                    if (!captureSince(epoch)) break;
+                    qDebug() << "Calibration interrupted by capture, retry" << model << provider << threads;
+                }
+                if (g_cancelCalibration) break;
+
+                if (progress) {
+                    progress(++done, total);
+                }
+                if (seconds < 0) {
+                    qDebug() << "Calibration skipped" << model << provider << threads;
+                    continue;
+                }
+                qDebug() << "Calibration" << model << provider << threads
+                         << "RTF" << seconds / audioSeconds;
+
+                if (bestSeconds < 0 || seconds < bestSeconds) {
+                    bestSeconds = seconds;
+                    best = candidate;
+                    best.rtf = seconds / audioSeconds;
+                }
+            }
+        }
+    }
+
+    for (const SherpaOnnxWave *wave : waves) {
+        SherpaOnnxFreeWave(wave);
+    }
+
+    if (g_cancelCalibration) {
+        qDebug() << "Calibration cancelled";
+        return profile();
+    }
+
+    if (bestSeconds >= 0) {
+        store(best);
+        std::lock_guard<std::mutex> lock(g_profileMutex);
+        g_profile = best;
+        g_profileLoaded = true;
+        g_calibrated = true;
+        qDebug() << "Calibrated profile for" << cpuKey() << ":" << best.model
+                 << best.provider << best.numThreads << "RTF" << best.rtf;
+    }
+    return best;
+}
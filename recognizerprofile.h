@@ -0,0 +1,61 @@
+#ifndef RECOGNIZERPROFILE_H
+#define RECOGNIZERPROFILE_H
+
+#include <QString>
+#include <QStringList>
+#include <c-api.h>
+
+#include <functional>
+
+// 识别器配置：模型文件、推理后端、线程数、解码方式
+struct RecognizerProfile
+{
+    QString model = "sherpa-onnx-paraformer-zh-small/model.int8.onnx";
+    QString tokens = "sherpa-onnx-paraformer-zh-small/tokens.txt";
+    QString provider = "cpu";
+    int32_t numThreads = 2;
+    QString decodingMethod = "greedy_search";
+    double rtf = 0.0;  // 校准时测得的实时率，0 表示未校准
+};
+
+// 按本机 CPU 特性选择最快的识别器配置
+// 在自带语料上测试各模型、后端和线程数，结果按 CPU 特性缓存到 recognizer_profile.ini
+// 首次运行时在后台线程校准，完成前使用默认配置；有采集进行时校准暂停
+class RecognizerCalibration
+{
+public:
+    using Progress = std::function<void(int done, int total)>;
+    using Finished = std::function<void(const RecognizerProfile &profile)>;
+
+    // 返回当前 CPU 的配置；没有缓存且后台校准尚未完成时返回默认配置
+    static RecognizerProfile profile();
+
+    // 有缓存或本次运行已完成校准
+    static bool isCalibrated();
+
+    // 重新校准并写入缓存，阻塞直到完成；progress 在每测完一种配置后调用
+    static RecognizerProfile calibrate(const Progress &progress = Progress());
+
+    // 在后台线程校准，回调在后台线程上调用；已有后台校准在进行时忽略
+    static void calibrateInBackground(const Progress &progress, const Finished &finished);
+    // 中止后台校准并等待线程退出，中止时不写缓存
+    static void cancelBackgroundCalibration();
+
+    // 采集开始、结束时调用。有采集进行时校准暂停，不与实时解码争抢 CPU；
+    // 测量期间开始过采集的配置作废，空闲后重测
+    static void captureStarted();
+    static void captureStopped();
+
+    // CPU 架构、SIMD 特性和逻辑核数组成的缓存键，例如 x86_64-avx2-avxvnni-t16
+    static QString cpuKey();
+
+    // numThreads 大于 0 时覆盖配置中的线程数
+    static const SherpaOnnxOfflineRecognizer *createRecognizer(const RecognizerProfile &profile,
+                                                               int32_t numThreads = 0);
+
+private:
+    static bool loadCached(RecognizerProfile *profile);
+    static void store(const RecognizerProfile &profile);
+};
+
+#endif // RECOGNIZERPROFILE_H
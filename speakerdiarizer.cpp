@@ -0,0 +1,216 @@
+#include "speakerdiarizer.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define DIARIZER_USE_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DIARIZER_USE_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define DIARIZER_USE_NEON 1
+#endif
+
+namespace {
+
+// 两个向量的点积；向量已归一化，点积即余弦相似度
+float dot(const float *a, const float *b, int32_t n)
+{
+    int32_t i = 0;
+    float sum = 0.0f;
+
+#if defined(DIARIZER_USE_AVX2)
+    __m256 acc = _mm256_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc);
+    }
+    __m128 lo = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 1));
+    sum = _mm_cvtss_f32(lo);
+#elif defined(DIARIZER_USE_SSE2)
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    sum = _mm_cvtss_f32(acc);
+#elif defined(DIARIZER_USE_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; i + 4 <= n; i += 4) {
+        acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    sum = vaddvq_f32(acc);
+#endif
+
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+void normalize(float *v, int32_t n)
+{
+    const float norm = std::sqrt(dot(v, v, n));
+    if (norm > 0.0f) {
+        for (int32_t i = 0; i < n; ++i) v[i] /= norm;
+    }
+}
+
+} // namespace
+
+SpeakerDiarizer::SpeakerDiarizer(const char *modelFilename, int numWorkers,
+                                 float threshold, QObject *parent)
+    : QObject(parent)
+    , m_threshold(threshold)
+{
+    if (!SherpaOnnxFileExists(modelFilename)) {
+        fprintf(stderr, "Speaker embedding model %s not found, diarization disabled\n",
+                modelFilename);
+        return;
+    }
+
+    SherpaOnnxSpeakerEmbeddingExtractorConfig config;
+    memset(&config, 0, sizeof(config));
+    config.model = modelFilename;
+    config.num_threads = 1;   // 并行度由工作线程数决定
+    config.debug = 0;
+    config.provider = "cpu";
+
+    m_extractor = SherpaOnnxCreateSpeakerEmbeddingExtractor(&config);
+    if (m_extractor == NULL) {
+        fprintf(stderr, "Please check your speaker embedding config!\n");
+        return;
+    }
+    m_dim = SherpaOnnxSpeakerEmbeddingExtractorDim(m_extractor);
+
+    for (int i = 0; i < qMax(numWorkers, 1); ++i) {
+        m_workers.emplace_back(&SpeakerDiarizer::workerLoop, this);
+    }
+}
+
+SpeakerDiarizer::~SpeakerDiarizer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_stop = true;
+    }
+    m_queueCondition.notify_all();
+    for (std::thread &worker : m_workers) {
+        worker.join();
+    }
+
+    if (m_extractor) {
+        SherpaOnnxDestroySpeakerEmbeddingExtractor(m_extractor);
+    }
+}
+
+void SpeakerDiarizer::submit(qint64 id, const float *samples, int32_t n)
+{
+    if (!isReady() || n <= 0) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_queue.push_back(Job{id, std::vector<float>(samples, samples + n)});
+    }
+    m_queueCondition.notify_one();
+}
+
+int SpeakerDiarizer::numSpeakers() const
+{
+    std::lock_guard<std::mutex> lock(m_clusterMutex);
+    return static_cast<int>(m_clusterSizes.size());
+}
+
+void SpeakerDiarizer::workerLoop()
+{
+    std::vector<Job> batch;
+    std::vector<std::vector<float>> embeddings;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_queueCondition.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+            if (m_stop) return;
+
+            // 一次取走积压的多个片段，减少加锁次数
+            batch.clear();
+            while (!m_queue.empty() && static_cast<int>(batch.size()) < kMaxBatch) {
+                batch.push_back(std::move(m_queue.front()));
+                m_queue.pop_front();
+            }
+        }
+
+        embeddings.resize(batch.size());
+        std::vector<bool> valid(batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            valid[i] = computeEmbedding(batch[i], embeddings[i]);
+        }
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (!valid[i]) continue;
+            const int speaker = assignSpeaker(embeddings[i]);
+            emit speakerAssigned(batch[i].id, QString("说话人%1").arg(speaker + 1));
+        }
+    }
+}
+
+bool SpeakerDiarizer::computeEmbedding(const Job &job, std::vector<float> &embedding) const
+{
+    const SherpaOnnxOnlineStream *stream = SherpaOnnxSpeakerEmbeddingExtractorCreateStream(m_extractor);
+    SherpaOnnxOnlineStreamAcceptWaveform(stream, 16000, job.samples.data(),
+                                         static_cast<int32_t>(job.samples.size()));
+    SherpaOnnxOnlineStreamInputFinished(stream);
+
+    // 片段太短时特征帧不够，不计算说话人
+    bool ok = false;
+    if (SherpaOnnxSpeakerEmbeddingExtractorIsReady(m_extractor, stream)) {
+        const float *v = SherpaOnnxSpeakerEmbeddingExtractorComputeEmbedding(m_extractor, stream);
+        embedding.assign(v, v + m_dim);
+        SherpaOnnxSpeakerEmbeddingExtractorDestroyEmbedding(v);
+        normalize(embedding.data(), m_dim);
+        ok = true;
+    }
+
+    SherpaOnnxDestroyOnlineStream(stream);
+    return ok;
+}
+
+int SpeakerDiarizer::assignSpeaker(std::vector<float> &embedding)
+{
+    std::lock_guard<std::mutex> lock(m_clusterMutex);
+
+    int best = -1;
+    float bestScore = m_threshold;
+    const int numClusters = static_cast<int>(m_clusterSizes.size());
+    for (int c = 0; c < numClusters; ++c) {
+        const float score = dot(embedding.data(), m_centroids.data() + c * m_dim, m_dim);
+        if (score >= bestScore) {
+            bestScore = score;
+            best = c;
+        }
+    }
+
+    if (best < 0) {
+        m_centroids.insert(m_centroids.end(), embedding.begin(), embedding.end());
+        m_clusterSizes.push_back(1);
+        return numClusters;
+    }
+
+    // 中心向量取累计平均后重新归一化
+    float *centroid = m_centroids.data() + best * m_dim;
+    const float weight = static_cast<float>(m_clusterSizes[best]);
+    for (int32_t i = 0; i < m_dim; ++i) {
+        centroid[i] = centroid[i] * weight + embedding[i];
+    }
+    normalize(centroid, m_dim);
+    ++m_clusterSizes[best];
+    return best;
+}
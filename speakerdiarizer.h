@@ -0,0 +1,64 @@
+#ifndef SPEAKERDIARIZER_H
+#define SPEAKERDIARIZER_H
+
+#include <QObject>
+#include <QString>
+#include <c-api.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 在线说话人分离：与识别并行地为每个语音片段计算说话人向量，并做增量聚类
+// 工作线程每次取出积压的一批片段处理，结果通过 speakerAssigned 信号返回，不阻塞识别
+class SpeakerDiarizer : public QObject
+{
+    Q_OBJECT
+public:
+    // threshold 为余弦相似度阈值，低于该值的片段归为新说话人
+    explicit SpeakerDiarizer(const char *modelFilename, int numWorkers = 2,
+                             float threshold = 0.5f, QObject *parent = nullptr);
+    ~SpeakerDiarizer();
+
+    bool isReady() const { return m_extractor != NULL; }
+
+    // 提交一个 16kHz 片段，samples 会被复制
+    void submit(qint64 id, const float *samples, int32_t n);
+
+    int numSpeakers() const;
+
+public:signals:
+    void speakerAssigned(qint64 id, const QString &label);
+
+private:
+    struct Job
+    {
+        qint64 id;
+        std::vector<float> samples;
+    };
+
+    void workerLoop();
+    bool computeEmbedding(const Job &job, std::vector<float> &embedding) const;
+    int assignSpeaker(std::vector<float> &embedding);
+
+    const SherpaOnnxSpeakerEmbeddingExtractor *m_extractor = NULL;
+    int32_t m_dim = 0;
+    float m_threshold;
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCondition;
+    std::deque<Job> m_queue;
+    bool m_stop = false;
+
+    // 每个说话人的归一化中心向量，连续存放便于 SIMD 打分
+    mutable std::mutex m_clusterMutex;
+    std::vector<float> m_centroids;
+    std::vector<int> m_clusterSizes;
+
+    static const int kMaxBatch = 8;
+};
+
+#endif // SPEAKERDIARIZER_H
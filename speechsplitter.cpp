@@ -0,0 +1,69 @@
+#include "speechsplitter.h"
+
+#include <algorithm>
+#include <limits>
+
+SpeechSplitter::SpeechSplitter(int32_t targetSamples, int32_t searchSamples, int32_t windowSamples)
+    : m_targetSamples(std::max<int32_t>(targetSamples, 1))
+    , m_searchSamples(std::max<int32_t>(searchSamples, 0))
+    , m_windowSamples(std::max<int32_t>(windowSamples, 1))
+{
+}
+
+int32_t SpeechSplitter::findQuietestPoint(const float *samples, int32_t begin, int32_t end) const
+{
+    if (end - begin <= m_windowSamples) {
+        return begin + (end - begin) / 2;
+    }
+
+    // 滑动窗口累加能量，避免每个位置重新求和
+    double energy = 0.0;
+    for (int32_t i = begin; i < begin + m_windowSamples; ++i) {
+        energy += samples[i] * samples[i];
+    }
+
+    double minEnergy = energy;
+    int32_t minPos = begin;
+    for (int32_t i = begin + 1; i + m_windowSamples <= end; ++i) {
+        const float out = samples[i - 1];
+        const float in = samples[i + m_windowSamples - 1];
+        energy += in * in - out * out;
+        if (energy < minEnergy) {
+            minEnergy = energy;
+            minPos = i;
+        }
+    }
+
+    return minPos + m_windowSamples / 2;
+}
+
+int32_t SpeechSplitter::nextCut(const float *samples, int32_t cursor, int32_t n) const
+{
+    // 需要目标点之后还有完整的搜索范围，才能保证找到的是真正的低能量点
+    if (n - cursor < m_targetSamples + m_searchSamples) {
+        return -1;
+    }
+
+    const int32_t begin = cursor + m_targetSamples - m_searchSamples;
+    const int32_t end = cursor + m_targetSamples + m_searchSamples;
+    return findQuietestPoint(samples, std::max(begin, cursor + 1), end);
+}
+
+std::vector<std::pair<int32_t, int32_t>> SpeechSplitter::split(const float *samples, int32_t n) const
+{
+    std::vector<std::pair<int32_t, int32_t>> pieces;
+    int32_t cursor = 0;
+
+    int32_t cut = nextCut(samples, cursor, n);
+    while (cut > cursor) {
+        pieces.emplace_back(cursor, cut);
+        cursor = cut;
+        cut = nextCut(samples, cursor, n);
+    }
+
+    // 剩余部分不足以再切分，作为最后一段
+    if (cursor < n) {
+        pieces.emplace_back(cursor, n);
+    }
+    return pieces;
+}
@@ -0,0 +1,34 @@
+#ifndef SPEECHSPLITTER_H
+#define SPEECHSPLITTER_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// 在低能量处切分长语音段，切出的片段可以批量并行解码
+class SpeechSplitter
+{
+public:
+    // targetSamples: 目标片段长度；searchSamples: 在目标点前后搜索最安静点的范围；
+    // windowSamples: 计算短时能量的窗口大小
+    SpeechSplitter(int32_t targetSamples, int32_t searchSamples, int32_t windowSamples);
+
+    // 返回 [begin, end) 片段列表，覆盖整个 [0, n)
+    std::vector<std::pair<int32_t, int32_t>> split(const float *samples, int32_t n) const;
+
+    // 在 [begin, end) 范围内找短时能量最低的窗口，返回该窗口中心位置
+    int32_t findQuietestPoint(const float *samples, int32_t begin, int32_t end) const;
+
+    // 从 cursor 开始，若剩余数据足够切出一个目标长度片段，返回切点，否则返回 -1
+    int32_t nextCut(const float *samples, int32_t cursor, int32_t n) const;
+
+    int32_t targetSamples() const { return m_targetSamples; }
+    int32_t searchSamples() const { return m_searchSamples; }
+
+private:
+    int32_t m_targetSamples;
+    int32_t m_searchSamples;
+    int32_t m_windowSamples;
+};
+
+#endif // SPEECHSPLITTER_H
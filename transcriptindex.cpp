@@ -0,0 +1,310 @@
+#include "transcriptindex.h"
+
+#include <algorithm>
+#include <iterator>
+
+TranscriptIndex::TranscriptIndex(int shardSize, int maxShards)
+    : m_shardSize(qMax(shardSize, 1))
+    , m_maxShards(qMax(maxShards, 1))
+{
+}
+
+QString TranscriptIndex::normalize(const QString &text)
+{
+    QString result;
+    result.reserve(text.size());
+    for (QChar c : text) {
+        if (c.isSpace() || c.isPunct()) continue;
+        result.append(c.toLower());
+    }
+    return result;
+}
+
+quint32 TranscriptIndex::gramKey(QChar a, QChar b)
+{
+    return (static_cast<quint32>(a.toLower().unicode()) << 16) | b.toLower().unicode();
+}
+
+void TranscriptIndex::gramKeys(const QString &text, std::vector<quint32> &keys)
+{
+    // 单字索引项的第二个字符为 0，不会与二元组冲突
+    keys.clear();
+    for (int i = 0; i < text.size(); ++i) {
+        keys.push_back(gramKey(text[i], QChar()));
+        if (i + 1 < text.size()) {
+            keys.push_back(gramKey(text[i], text[i + 1]));
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+size_t TranscriptIndex::appendPosting(Posting &posting, quint32 local)
+{
+    // 同一片段内重复出现的索引项只记录一次
+    if (posting.count > 0 && posting.last == local) return 0;
+
+    size_t added = 0;
+    quint32 delta = local - posting.last;
+    if (posting.count % kBlockSize == 0) {
+        // 新块的第一项存绝对值，各块可以独立解码
+        posting.blocks.push_back(Block{local, static_cast<quint32>(posting.bytes.size())});
+        delta = local;
+        added += sizeof(Block);
+    }
+
+    const size_t before = posting.bytes.size();
+    while (delta >= 0x80) {
+        posting.bytes.push_back(static_cast<quint8>(delta | 0x80));
+        delta >>= 7;
+    }
+    posting.bytes.push_back(static_cast<quint8>(delta));
+    added += posting.bytes.size() - before;
+
+    posting.last = local;
+    ++posting.count;
+    return added;
+}
+
+qint64 TranscriptIndex::add(const VoiceData &data)
+{
+    if (m_shards.empty() || m_shards.back().segments.size() >= m_shardSize) {
+        m_shards.emplace_back();
+        m_shards.back().firstId = m_nextId;
+        if (static_cast<int>(m_shards.size()) > m_maxShards) {
+            m_shards.pop_front();
+        }
+    }
+
+    Shard &shard = m_shards.back();
+    const quint32 local = static_cast<quint32>(shard.segments.size());
+    shard.segments.append(data);
+    shard.normalized.append(normalize(data.context));
+
+    std::vector<quint32> keys;
+    gramKeys(shard.normalized.back(), keys);
+    for (quint32 key : keys) {
+        shard.postingBytes += appendPosting(shard.postings[key], local);
+    }
+
+    return m_nextId++;
+}
+
+void TranscriptIndex::update(qint64 id, const VoiceData &data)
+{
+    auto shardIt = std::find_if(m_shards.begin(), m_shards.end(), [id](const Shard &shard) {
+        return id >= shard.firstId && id < shard.firstId + shard.segments.size();
+    });
+    if (shardIt == m_shards.end()) return;
+
+    Shard &shard = *shardIt;
+    const quint32 local = static_cast<quint32>(id - shard.firstId);
+    shard.segments[local] = data;
+
+    // 补标点只改变空白和标点，规范化后的文本不变，不需要重建索引项
+    const QString text = normalize(data.context);
+    if (text == shard.normalized[local]) return;
+
+    std::vector<quint32> oldKeys;
+    std::vector<quint32> newKeys;
+    gramKeys(shard.normalized[local], oldKeys);
+    gramKeys(text, newKeys);
+    shard.normalized[local] = text;
+
+    // 不再出现的索引项保留在倒排表中，查询时逐条确认会把它们过滤掉；只补充新出现的项
+    std::vector<quint32> added;
+    std::set_difference(newKeys.begin(), newKeys.end(), oldKeys.begin(), oldKeys.end(),
+                        std::back_inserter(added));
+    for (quint32 key : added) {
+        Posting &posting = shard.postings[key];
+        if (posting.count == 0 || posting.last <= local) {
+            shard.postingBytes += appendPosting(posting, local);
+            continue;
+        }
+
+        // 倒排表末尾已有更新的片段，只能放进补充表
+        std::vector<quint32> &late = shard.late[key];
+        const auto pos = std::lower_bound(late.begin(), late.end(), local);
+        if (pos == late.end() || *pos != local) {
+            late.insert(pos, local);
+            shard.postingBytes += sizeof(quint32);
+        }
+    }
+}
+
+void TranscriptIndex::decodeBlock(const Posting &posting, size_t block, std::vector<quint32> &out)
+{
+    out.clear();
+    const size_t begin = posting.blocks[block].offset;
+    const size_t end = block + 1 < posting.blocks.size() ? posting.blocks[block + 1].offset
+                                                         : posting.bytes.size();
+    quint32 value = 0;
+    quint32 delta = 0;
+    int shift = 0;
+    for (size_t i = begin; i < end; ++i) {
+        const quint8 byte = posting.bytes[i];
+        delta |= static_cast<quint32>(byte & 0x7f) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        value = out.empty() ? delta : value + delta;
+        out.push_back(value);
+        delta = 0;
+        shift = 0;
+    }
+}
+
+bool TranscriptIndex::PostingCursor::floor(quint32 local, quint32 *value)
+{
+    quint32 fromPosting = 0;
+    const bool inPosting = m_posting && postingFloor(local, &fromPosting);
+
+    bool inLate = false;
+    quint32 fromLate = 0;
+    if (m_late) {
+        const auto it = std::upper_bound(m_late->begin(), m_late->end(), local);
+        if (it != m_late->begin()) {
+            inLate = true;
+            fromLate = *(it - 1);
+        }
+    }
+
+    if (!inPosting && !inLate) return false;
+    *value = !inLate ? fromPosting : !inPosting ? fromLate : qMax(fromPosting, fromLate);
+    return true;
+}
+
+bool TranscriptIndex::PostingCursor::postingFloor(quint32 local, quint32 *value)
+{
+    // 查找的值只会越来越小：仍在当前块内时从上次的位置往前走，否则二分查找所在的块
+    const auto &blocks = m_posting->blocks;
+    if (m_block < 0 || local < blocks[m_block].first) {
+        const auto block = std::upper_bound(blocks.begin(), blocks.end(), local,
+                                            [](quint32 v, const Block &b) { return v < b.first; });
+        if (block == blocks.begin()) return false;
+        m_block = static_cast<long>(block - blocks.begin()) - 1;
+        decodeBlock(*m_posting, static_cast<size_t>(m_block), m_values);
+        m_pos = m_values.size() - 1;
+    }
+    // 块内第一项就是块首，一定不大于 local
+    while (m_values[m_pos] > local) {
+        --m_pos;
+    }
+    *value = m_values[m_pos];
+    return true;
+}
+
+void TranscriptIndex::searchShard(const Shard &shard, const QString &query, int limit,
+                                  QVector<TranscriptHit> &hits) const
+{
+    // 收集查询中的索引项
+    std::vector<quint32> keys;
+    if (query.size() < 2) {
+        keys.push_back(gramKey(query[0], QChar()));
+    } else {
+        for (int i = 0; i + 1 < query.size(); ++i) {
+            keys.push_back(gramKey(query[i], query[i + 1]));
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    }
+
+    struct List
+    {
+        const Posting *posting;
+        const std::vector<quint32> *late;
+        size_t count;
+    };
+    std::vector<List> lists;
+    for (quint32 key : keys) {
+        List list{nullptr, nullptr, 0};
+        auto posting = shard.postings.find(key);
+        if (posting != shard.postings.end()) {
+            list.posting = &posting->second;
+            list.count += posting->second.count;
+        }
+        auto late = shard.late.find(key);
+        if (late != shard.late.end()) {
+            list.late = &late->second;
+            list.count += late->second.size();
+        }
+        if (list.count == 0) return;
+        lists.push_back(list);
+    }
+    // 最短的倒排表放在前面，候选跳得最快
+    std::sort(lists.begin(), lists.end(),
+              [](const List &a, const List &b) { return a.count < b.count; });
+
+    std::vector<PostingCursor> cursors;
+    for (const List &list : lists) {
+        cursors.emplace_back(list.posting, list.late);
+    }
+
+    // 从新到旧求交集：各倒排表轮流把候选降到自己不大于它的最大项，
+    // 连续 n 个倒排表都落在同一个候选上即为交集中的一项；凑够 limit 条即停止
+    quint32 candidate = static_cast<quint32>(shard.segments.size() - 1);
+    size_t agreed = 0;
+    for (size_t j = 0;; j = (j + 1) % cursors.size()) {
+        quint32 value;
+        if (!cursors[j].floor(candidate, &value)) return;
+        if (value == candidate) {
+            ++agreed;
+        } else {
+            candidate = value;
+            agreed = 1;
+        }
+        if (agreed < cursors.size()) continue;
+
+        // 二元组都出现不代表相邻出现，逐条确认
+        if (shard.normalized[candidate].contains(query)) {
+            hits.append(TranscriptHit{shard.firstId + candidate, shard.segments[candidate]});
+            if (hits.size() >= limit) return;
+        }
+        if (candidate == 0) return;
+        --candidate;
+        agreed = 0;
+    }
+}
+
+QVector<TranscriptHit> TranscriptIndex::search(const QString &query, int limit) const
+{
+    QVector<TranscriptHit> hits;
+    const QString normalized = normalize(query);
+    if (normalized.isEmpty()) return hits;
+
+    for (auto it = m_shards.rbegin(); it != m_shards.rend() && hits.size() < limit; ++it) {
+        searchShard(*it, normalized, limit, hits);
+    }
+    return hits;
+}
+
+qint64 TranscriptIndex::size() const
+{
+    qint64 total = 0;
+    for (const Shard &shard : m_shards) {
+        total += shard.segments.size();
+    }
+    return total;
+}
+
+size_t TranscriptIndex::memoryUsage() const
+{
+    size_t total = 0;
+    for (const Shard &shard : m_shards) {
+        total += shard.postingBytes;
+        total += shard.postings.size() * (sizeof(quint32) + sizeof(Posting) + 2 * sizeof(void *));
+        for (const VoiceData &data : shard.segments) {
+            total += sizeof(VoiceData) + data.context.size() * sizeof(QChar);
+        }
+        for (const QString &text : shard.normalized) {
+            total += sizeof(QString) + text.size() * sizeof(QChar);
+        }
+    }
+    return total;
+}
+
+void TranscriptIndex::clear()
+{
+    m_shards.clear();
+}
@@ -0,0 +1,104 @@
+#ifndef TRANSCRIPTINDEX_H
+#define TRANSCRIPTINDEX_H
+
+#include "audiocapture.h"
+
+#include <QString>
+#include <QVector>
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+struct TranscriptHit
+{
+    qint64 id;  // 片段加入索引的序号
+    VoiceData data;
+};
+
+// 实时转写文本的增量倒排索引
+// 以字符二元组为索引项（单字查询使用单字索引项），中文不需要分词；倒排表按片段序号差值做变长编码，
+// 每 kBlockSize 项一块并记录块首序号。查询时各倒排表从新到旧交替跳跃求交集，凑够 limit 条即停止。
+// 索引和匹配都忽略空白和标点，补标点前后的文本、以及从界面复制的带标点查询都能找到。
+// 索引按 shardSize 个片段分片，超过 maxShards 时丢弃最旧的分片，内存有上限。
+class TranscriptIndex
+{
+public:
+    explicit TranscriptIndex(int shardSize = 65536, int maxShards = 16);
+
+    // 加入一个片段，返回其序号
+    qint64 add(const VoiceData &data);
+
+    // 替换序号为 id 的片段（补标点、说话人标签、文本变长）；片段已被丢弃时忽略
+    void update(qint64 id, const VoiceData &data);
+
+    // 查找包含 query 的片段（不区分大小写，忽略空白和标点），按时间从新到旧返回至多 limit 条
+    QVector<TranscriptHit> search(const QString &query, int limit = 100) const;
+
+    qint64 size() const;
+    size_t memoryUsage() const;
+    void clear();
+
+private:
+    struct Block
+    {
+        quint32 first;   // 块内第一个片段序号
+        quint32 offset;  // 块在 bytes 中的起始位置
+    };
+
+    struct Posting
+    {
+        std::vector<quint8> bytes;    // 片段序号差值的变长编码，每块第一项存绝对值
+        std::vector<Block> blocks;
+        quint32 last = 0;
+        quint32 count = 0;
+    };
+
+    // 按块解码的倒排表游标，只解码被访问到的块；late 为更新时补入的项
+    class PostingCursor
+    {
+    public:
+        PostingCursor(const Posting *posting, const std::vector<quint32> *late)
+            : m_posting(posting), m_late(late) {}
+        // 倒排表中不大于 local 的最大片段序号，没有时返回 false；local 必须逐次不增
+        bool floor(quint32 local, quint32 *value);
+
+    private:
+        bool postingFloor(quint32 local, quint32 *value);
+
+        const Posting *m_posting;
+        const std::vector<quint32> *m_late;
+        long m_block = -1;
+        size_t m_pos = 0;
+        std::vector<quint32> m_values;
+    };
+
+    struct Shard
+    {
+        qint64 firstId = 0;
+        QVector<VoiceData> segments;
+        QVector<QString> normalized;  // 去掉空白和标点并转小写的文本，用于确认匹配
+        std::unordered_map<quint32, Posting> postings;
+        // 片段更新后新出现、又不能追加到倒排表末尾的索引项，按片段序号有序
+        std::unordered_map<quint32, std::vector<quint32>> late;
+        size_t postingBytes = 0;
+    };
+
+    static QString normalize(const QString &text);
+    static quint32 gramKey(QChar a, QChar b);
+    static void gramKeys(const QString &text, std::vector<quint32> &keys);
+    // 返回新增的字节数
+    static size_t appendPosting(Posting &posting, quint32 local);
+    static void decodeBlock(const Posting &posting, size_t block, std::vector<quint32> &out);
+    void searchShard(const Shard &shard, const QString &query, int limit,
+                     QVector<TranscriptHit> &hits) const;
+
+    int m_shardSize;
+    int m_maxShards;
+    qint64 m_nextId = 0;
+    std::deque<Shard> m_shards;
+
+    static constexpr quint32 kBlockSize = 128;
+};
+
+#endif // TRANSCRIPTINDEX_H